@@ -0,0 +1,238 @@
+//
+//    Simbrief Hub: A central resource of simbrief data for other plugins
+//
+//    Copyright (C) 2025 Holger Teutsch
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Lesser General Public
+//    License as published by the Free Software Foundation; either
+//    version 2.1 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+//    USA
+//
+
+// Offline test of the concurrent query of the cdm servers in CdmGetParse().
+// Two vIFF stub servers on localhost answer per callsign with a configured delay and status.
+// Checks that the result follows the priority of the configuration and not the order of arrival
+// and that the requests of lower priority are cancelled once a winner is known.
+// A repeated query of a flight gets a 304 and must yield the cached result.
+//
+// call with
+// cdm_fanout_test
+// exit status 0 = all checks passed
+//
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <map>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#include "sbh.h"
+#include "http_fetch.h"
+
+const char* log_msg_prefix = "cdm_fanout_test: ";
+
+// vIFF server on localhost, the response is looked up by callsign
+class StubServer {
+   public:
+    struct Reply {
+        int delay_ms;
+        int status;        // 200 = flight found with the server's tsat, else an empty response
+                           // a 200 is revalidated with 304
+    };
+
+   private:
+    int fd_{-1};
+    int port_{0};
+    std::string tsat_;
+    std::map<std::string, Reply> replies_;
+
+    void Serve(int conn) {
+        char buf[2048];
+        ssize_t n = recv(conn, buf, sizeof(buf) - 1, 0);
+        if (n <= 0) {
+            close(conn);
+            return;
+        }
+        buf[n] = '\0';
+
+        // "GET /ifps/callsign?callsign=XXX HTTP/1.1"
+        std::string req(buf);
+        std::string callsign;
+        auto i = req.find("callsign=");
+        if (i != std::string::npos)
+            callsign = req.substr(i + 9, req.find(' ', i) - i - 9);
+
+        n_requests++;
+        auto it = replies_.find(callsign);
+        Reply reply = (it != replies_.end()) ? it->second : Reply{0, 404};
+        std::this_thread::sleep_for(std::chrono::milliseconds(reply.delay_ms));
+
+        std::string body, etag;
+        if (reply.status == 200) {
+            etag = "ETag: \"" + tsat_ + "\"\r\n";
+            if (req.find("If-None-Match: \"" + tsat_ + "\"") != std::string::npos)
+                reply.status = 304;
+            else
+                body = R"({"departure":"EDDM","cdmData":{"tobt":"0935","tsat":")" + tsat_ +
+                       R"(","depInfo":"26R/TOLTA1F","confirmed":true}})";
+        }
+
+        std::string rsp = "HTTP/1.1 " + std::to_string(reply.status) + " X\r\n" + etag +
+                          "Content-Type: application/json\r\nConnection: close\r\nContent-Length: " +
+                          std::to_string(body.length()) + "\r\n\r\n" + body;
+        send(conn, rsp.data(), rsp.length(), MSG_NOSIGNAL);  // the client may have gone
+        close(conn);
+    }
+
+   public:
+    std::atomic<int> n_requests{0};
+
+    StubServer(const std::string& tsat, std::map<std::string, Reply> replies)
+        : tsat_(tsat), replies_(std::move(replies)) {
+        fd_ = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;  // any
+        socklen_t len = sizeof(addr);
+        if (bind(fd_, (sockaddr*)&addr, len) < 0 || listen(fd_, 16) < 0 ||
+            getsockname(fd_, (sockaddr*)&addr, &len) < 0) {
+            LogMsg("can't create stub server: %s", strerror(errno));
+            exit(2);
+        }
+        port_ = ntohs(addr.sin_port);
+
+        // one thread per connection so a slow reply does not hold up the others
+        std::thread([this]() {
+            while (true) {
+                int conn = accept(fd_, nullptr, nullptr);
+                if (conn >= 0)
+                    std::thread(&StubServer::Serve, this, conn).detach();
+            }
+        }).detach();
+    }
+
+    std::string url() const {
+        return "http://127.0.0.1:" + std::to_string(port_);
+    }
+};
+
+static int n_failed;
+
+#define CHECK(cond)                                        \
+    do {                                                   \
+        if (!(cond)) {                                     \
+            LogMsg("FAILED line %d: %s", __LINE__, #cond); \
+            n_failed++;                                    \
+        }                                                  \
+    } while (0)
+
+// CdmGetParse() for callsign, ms receives the elapsed time
+static bool Query(const std::string& callsign, std::unique_ptr<CdmInfo>& cdm_info, int& ms) {
+    auto t0 = std::chrono::steady_clock::now();
+    bool res = CdmGetParse("EDDM", callsign, cdm_info);
+    ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0).count();
+    LogMsg("%s: res %d, status '%s', tsat '%s', %d ms", callsign.c_str(), res, cdm_info->status().data(),
+           cdm_info->tsat().data(), ms);
+    return res;
+}
+
+int main() {
+    // never deleted, the connection threads are detached
+    auto* first = new StubServer("1001", {
+                                             {"PRIO1", {300, 200}},   // slow but first in priority
+                                             {"FALL1", {0, 404}},     // unknown here
+                                             {"CANC1", {0, 200}},
+                                             {"NONE1", {0, 404}},
+                                             {"DOWN1", {0, 500}},
+                                         });
+    auto* second = new StubServer("1002", {
+                                              {"PRIO1", {0, 200}},
+                                              {"FALL1", {100, 200}},
+                                              {"CANC1", {5000, 200}},  // would hold the query for 5 s
+                                              {"NONE1", {0, 404}},
+                                              {"DOWN1", {0, 503}},
+                                          });
+
+    auto cfg_path = std::filesystem::temp_directory_path() / "cdm_fanout_test.json";
+    {
+        std::ofstream f(cfg_path);
+        f << "stub servers\n#&*!\n{\"servers\": [\n"
+          << "{\"name\": \"first\", \"protocol\": \"viff\", \"url\": \"" << first->url() << "\", \"enabled\": true},\n"
+          << "{\"name\": \"second\", \"protocol\": \"viff\", \"url\": \"" << second->url() << "\", \"enabled\": true}\n"
+          << "]}\n";
+    }
+
+    bool init = CdmInit(cfg_path.string());
+    std::filesystem::remove(cfg_path);
+    if (!init) {
+        LogMsg("CdmInit() failed, bye!");
+        return 2;
+    }
+
+    std::unique_ptr<CdmInfo> cdm_info;
+    int ms;
+
+    // the faster answer of the second server does not win over the first
+    CHECK(Query("PRIO1", cdm_info, ms));
+    CHECK(cdm_info->tsat() == "1001");
+    CHECK(ms >= 300);
+
+    // the first server does not know the flight, the second one answers
+    CHECK(Query("FALL1", cdm_info, ms));
+    CHECK(cdm_info->tsat() == "1002");
+
+    // the first server wins at once, the pending request to the second one is cancelled
+    CHECK(Query("CANC1", cdm_info, ms));
+    CHECK(cdm_info->tsat() == "1001");
+    CHECK(ms < 2500);
+
+    // nobody knows the flight
+    CHECK(!Query("NONE1", cdm_info, ms));
+    CHECK(cdm_info->outcome == kCdmNotFound);
+    CHECK(cdm_info->status() == "Flight not found");
+
+    // both servers fail, that's not a missing flight
+    CHECK(!Query("DOWN1", cdm_info, ms));
+    CHECK(cdm_info->outcome == kCdmError);
+
+    // a known winner is asked alone and the unchanged flight is revalidated
+    int n_second = second->n_requests;
+    uint64_t n_not_modified = HttpGetStats().not_modified;
+    CHECK(Query("PRIO1", cdm_info, ms));
+    CHECK(cdm_info->tsat() == "1001");
+    CHECK(cdm_info->outcome == kCdmFound);
+    CHECK(cdm_info->status() == kSuccess);
+    CHECK(second->n_requests == n_second);
+    CHECK(HttpGetStats().not_modified == n_not_modified + 1);
+
+    CdmFini();
+    HttpFini();
+
+    if (n_failed) {
+        LogMsg("%d checks failed", n_failed);
+        return 1;
+    }
+
+    LogMsg("all checks passed");
+    return 0;
+}
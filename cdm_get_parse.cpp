@@ -19,9 +19,17 @@
 //    USA
 //
 
+#include <algorithm>
 #include <cassert>
+#include <ctime>
 #include <string>
 #include <fstream>
+#include <filesystem>
+#include <future>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <mutex>
 
 #define JSON_USE_IMPLICIT_CONVERSIONS 0
 #include "nlohmann/json.hpp"
@@ -30,20 +38,170 @@ using json = nlohmann::json;
 #include <vector>
 #include <unordered_map>
 #include "sbh.h"
-#include "http_get.h"
+#include "http_fetch.h"
+#include "json_scan.h"
 
 // https://viff-system.network/docs
 // deprecated: https://github.com/rpuig2001/CDM
 // deprecated: https://github.com/vACDM/vacdm-server
 
-static constexpr int kMaxRetries = 3;
+static int Now() {
+    return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+// Circuit breaker of a server.
+// closed: requests pass, kFailureThreshold consecutive failures open it.
+// open: requests are refused for a backoff period that doubles with each failed probe,
+//       kBackoffMin .. kBackoffMax with +-25% jitter so we don't hit a recovering server in lockstep.
+// half open: after the backoff a single probe request passes, success closes the breaker, failure reopens it.
+// Only transport errors, 5xx and garbage count as failure, a 4xx is a valid answer of a live server.
+// state and next_probe are read by the stats datarefs on the main thread.
+class CircuitBreaker {
+    static constexpr int kFailureThreshold = 2;
+    static constexpr int kBackoffMin = 30;        // s
+    static constexpr int kBackoffMax = 30 * 60;   // s
+
+    std::atomic<int> state_{kCdmClosed};
+    std::atomic<int> next_probe_{0};  // unix time
+    std::atomic<int> failures_{0};    // consecutive
+
+   public:
+    int state() const {
+        return state_;
+    }
+
+    int next_probe() const {
+        return next_probe_;
+    }
+
+    // may a request be sent?
+    bool Allow() {
+        if (state_ == kCdmClosed)
+            return true;
+
+        if (state_ == kCdmOpen && Now() >= next_probe_) {
+            state_ = kCdmHalfOpen;  // this is the probe
+            return true;
+        }
+
+        return false;
+    }
+
+    // after a request that passed Allow(), returns an unused probe e.g. if the airport is not served
+    void Done() {
+        if (state_ == kCdmHalfOpen)
+            state_ = kCdmOpen;
+    }
+
+    void Record(bool ok, const std::string& name) {
+        if (ok) {
+            if (state_ != kCdmClosed)
+                LogMsg("CdmServer '%s' is back, circuit closed", name.c_str());
+            state_ = kCdmClosed;
+            failures_ = 0;
+            next_probe_ = 0;
+            return;
+        }
+
+        int failures = ++failures_;
+        if (state_ == kCdmClosed && failures < kFailureThreshold)
+            return;
+
+        static thread_local std::minstd_rand rng{std::random_device{}()};
+        int n = std::min(failures - kFailureThreshold, 10);
+        int backoff = std::min(kBackoffMax, kBackoffMin << n);
+        backoff = std::uniform_int_distribution<int>(backoff * 3 / 4, backoff * 5 / 4)(rng);
+        next_probe_ = Now() + backoff;
+        state_ = kCdmOpen;
+        LogMsg("CdmServer '%s' failed %d times, circuit open for %d s", name.c_str(), failures, backoff);
+    }
+};
+
+using AirportList = std::unordered_map<std::string, std::string>;  // icao -> feed url or ""
+
+// Small LRU cache with string keys, most recently used first.
+// Holds a handful of entries so a linear search is fine. Not thread safe.
+template <typename V, size_t N>
+class LruCache {
+    std::vector<std::pair<std::string, V>> entries_;
+
+   public:
+    // returns nullptr on a miss, the pointer is valid until the next Insert() or Erase()
+    V* Find(const std::string& key) {
+        auto it = std::find_if(entries_.begin(), entries_.end(), [&key](const auto& e) { return e.first == key; });
+        if (it == entries_.end())
+            return nullptr;
+
+        std::rotate(entries_.begin(), it, it + 1);
+        return &entries_.front().second;
+    }
+
+    void Insert(const std::string& key, V&& val) {
+        Erase(key);
+        if (entries_.size() == N)
+            entries_.pop_back();
+        entries_.emplace(entries_.begin(), key, std::move(val));
+    }
+
+    void Erase(const std::string& key) {
+        std::erase_if(entries_, [&key](const auto& e) { return e.first == key; });
+    }
+};
 
 // cdm server abstract base class
 class CdmServer {
    protected:
     const std::string name_;
     const std::string url_;
-    int retries_left_{kMaxRetries};
+    CircuitBreaker breaker_;
+
+    // served airports for protocols that have a list, persisted in the airport cache
+    std::mutex airports_mutex_;
+    AirportList airports_;
+    int airports_ts_{0};            // unix time of the download, 0 = not loaded
+    std::future<void> revalidate_;  // background download of an expired list
+
+    // Recent flight responses, key = "arpt/callsign".
+    // A flight request sends the validators of the cached response and on 304 the cached result is
+    // reused without download and parse.
+    // Only used by the thread running CachedGetParse(), there is one at a time per server.
+    struct CachedResponse {
+        HttpValidators validators;
+        bool res;
+        CdmInfo cdm_info;
+    };
+
+    static constexpr size_t kResponseCacheSize = 4;
+    LruCache<CachedResponse, kResponseCacheSize> responses_;
+    const HttpValidators* flight_validators_{nullptr};  // sent with the current flight request
+    HttpResult flight_res_;                             // of the current flight request
+    bool reachable_{true};                              // the server answered the current request
+
+    // GetJson() with the outcome recorded by the breaker
+    // flight = conditional request for the flight data, see responses_
+    json FetchJson(const std::string& url, bool flight = false);
+
+    // same for a response that is scanned instead of parsed
+    bool FetchRaw(const std::string& url, std::string& data, bool flight = false);
+
+    // The flight request was answered with 304, the protocol returns at once and CachedGetParse()
+    // takes the cached result.
+    bool NotModified() const {
+        return flight_res_.status == 304;
+    }
+
+    // protocol specific download of the airport list
+    virtual bool DownloadAirports([[maybe_unused]] AirportList& airports) {
+        return false;
+    }
+
+    // Make the airport list available, from the cache or by download.
+    // An expired list is used while a fresh one is downloaded in the background.
+    bool RetrieveAirports();
+
+    // is icao in the airport list? feed_url receives the value
+    bool FindAirport(const std::string& icao, std::string& feed_url);
 
    public:
     CdmServer(const CdmServer&) = delete;
@@ -55,32 +213,62 @@ class CdmServer {
         return name_;
     }
 
-    bool is_dead() const{
-        return retries_left_ <= 0;
+    CircuitBreaker& breaker() {
+        return breaker_;
+    }
+
+    const std::string& url() const {
+        return url_;
     }
 
+    // false if the last CachedGetParse() failed by the network or the server, not by a missing flight
+    bool reachable() const {
+        return reachable_;
+    }
+
+    // airport cache
+    void SetAirports(AirportList&& airports, int ts);
+    void WriteAirports(std::ostream& f);
+
+    // add the distinct hosts of the feed urls in the airport list to origins
+    void FeedOrigins(std::vector<std::string>& origins);
+
+    // wait for a background download of the airport list
+    void WaitRevalidate();
+
     virtual bool CdmGetParse(const std::string& arpt_icao, const std::string& callsign, CdmInfo& cdm_info) = 0;
+
+    // CdmGetParse() through the response cache
+    bool CachedGetParse(const std::string& arpt_icao, const std::string& callsign, CdmInfo& cdm_info);
 };
 
 static std::vector<std::unique_ptr<CdmServer>> cdm_servers;
 
-// simple cache for the last successful request as the same flight is likely to be requested again and again
-static struct Cache {
-    std::string arpt_icao;
-    std::string callsign;
-    int idx;
-} cache;
-
+// The server that answered for recent flights, key = "arpt/callsign".
+// The same flight is likely to be requested again and again and keeping a few survives a quick
+// switch of airport or callsign e.g. by a re-dispatch.
+static LruCache<int, 8> winners;
+
+// persistent cache of the airport lists
+static std::string airport_cache_path;  // empty = no cache
+static int airport_list_ttl = 24 * 3600;
+static std::mutex airport_cache_mutex;
+static void SaveAirportCache();
+
+// limits of the poll schedule, "poll" object of the configuration
+static struct PollCfg {
+    int fast_s = 30;            // final minutes before TSAT
+    int default_s = 90;
+    int slow_s = 300;           // TSAT far off or no data yet
+    int not_found_max_s = 600;  // backoff limit
+    int near_min = 10;          // final minutes
+    int far_min = 30;           // TSAT is far off beyond this
+} poll_cfg;
 
 // cdm server for R. Puig's CDM legacy protocol
 class CdmServer_rpuig: public CdmServer {
-    bool retrieved_{false};
-
-    // icao -> url
-    std::unordered_map<std::string, std::string> arpt_urls_;
-
-    // retrieve airports from this server
-    bool RetrieveAirports();
+    // icao -> feed url
+    bool DownloadAirports(AirportList& airports) override;
 
    public:
     CdmServer_rpuig(const CdmServer_rpuig&) = delete;
@@ -104,13 +292,8 @@ class CdmServer_viff: public CdmServer {
 
 // cdm server for the vacdm legacy protocol
 class CdmServer_vacdm: public CdmServer {
-    bool retrieved_{false};
-
-    // served airports
-    std::unordered_map<std::string, bool> airports_;
-
-    // retrieve airports from this server
-    bool RetrieveAirports();
+    // icao -> ""
+    bool DownloadAirports(AirportList& airports) override;
 
    public:
     CdmServer_vacdm(const CdmServer_vacdm&) = delete;
@@ -125,11 +308,11 @@ class CdmServer_vacdm: public CdmServer {
 // some helpers
 //
 void CdmInfo::Dump() const {
-#define L(field) LogMsg(#field ": %s", field.c_str())
+#define L(field) LogMsg(#field ": %s", field().data())
     L(status);
     L(url);
 
-    if (status == kSuccess) {
+    if (status() == kSuccess) {
         L(tobt);
         L(tsat);
         L(runway);
@@ -139,23 +322,29 @@ void CdmInfo::Dump() const {
 }
 
 // Get json from url or return null object
-json GetJson(const std::string& url) {
-    std::string data;
-    data.reserve(20 * 1024);
-    bool res = HttpGet(url, data, 10);
+// With validators a 304 "Not Modified" returns a null object too, check result->status.
+json GetJson(const std::string& url, HttpResult* result = nullptr, const HttpValidators* validators = nullptr) {
+    HttpBuffer buffer;
+    std::string& data = buffer.str();
+    HttpResult local_res;
+    HttpResult& http_res = result ? *result : local_res;
+    bool res = HttpFetch(url, data, 10, &http_res, validators);
 
     if (!res) {
         LogMsg("Can't retrieve from '%s'", url.c_str());
         return json();
     }
 
+    if (http_res.status == 304)
+        return json();
+
     int len = data.length();
     if (len == 0) {
         LogMsg("Empty response from '%s'", url.c_str());
         return json();
     }
 
-    LogMsg("got data %d bytes", len);
+    LogMsg("got data %d bytes, %d on the wire", len, (int)http_res.wire_bytes);
 
     try {
         json data_obj = json::parse(data);
@@ -168,6 +357,175 @@ json GetJson(const std::string& url) {
     return json();
 }
 
+json CdmServer::FetchJson(const std::string& url, bool flight) {
+    HttpResult res;
+    json obj = GetJson(url, &res, flight ? flight_validators_ : nullptr);
+    if (!res.cancelled) {
+        bool ok = (res.status >= 200 && res.status < 300 && !obj.is_null()) || res.status == 304 ||
+                  (res.status >= 400 && res.status < 500);
+        breaker_.Record(ok, name_);
+        if (flight)
+            reachable_ = ok;
+    }
+    if (flight)
+        flight_res_ = std::move(res);
+    return obj;
+}
+
+bool CdmServer::FetchRaw(const std::string& url, std::string& data, bool flight) {
+    HttpResult res;
+    bool ok = HttpFetch(url, data, 10, &res, flight ? flight_validators_ : nullptr);
+    if (!res.cancelled) {
+        bool answered = (ok && !data.empty()) || res.status == 304 || (res.status >= 400 && res.status < 500);
+        breaker_.Record(answered, name_);
+        if (flight)
+            reachable_ = answered;
+    }
+    if (flight)
+        flight_res_ = std::move(res);
+    return ok && !data.empty();
+}
+
+bool CdmServer::CachedGetParse(const std::string& arpt_icao, const std::string& callsign, CdmInfo& cdm_info) {
+    const std::string key = arpt_icao + "/" + callsign;
+    CachedResponse* cached = responses_.Find(key);
+    flight_validators_ = cached ? &cached->validators : nullptr;
+    flight_res_ = HttpResult();
+    reachable_ = true;
+
+    bool res = CdmGetParse(arpt_icao, callsign, cdm_info);
+    flight_validators_ = nullptr;
+
+    if (cached && NotModified()) {
+        LogMsg("CDM data for '%s' on '%s' not modified", key.c_str(), name_.c_str());
+        cdm_info = cached->cdm_info;
+        return cached->res;
+    }
+
+    // keep the entry over transport errors and cancelled requests, the next request may revalidate it
+    if (flight_res_.status >= 200 && flight_res_.status < 300) {
+        if (flight_res_.validators.empty())
+            responses_.Erase(key);
+        else
+            responses_.Insert(key, CachedResponse{std::move(flight_res_.validators), res, cdm_info});
+    }
+
+    return res;
+}
+
+void CdmServer::SetAirports(AirportList&& airports, int ts) {
+    std::lock_guard<std::mutex> lock(airports_mutex_);
+    airports_ = std::move(airports);
+    airports_ts_ = ts;
+}
+
+void CdmServer::WaitRevalidate() {
+    std::future<void> revalidate;
+    {
+        std::lock_guard<std::mutex> lock(airports_mutex_);
+        revalidate = std::move(revalidate_);
+    }
+
+    // not under the lock, the download sets the airports
+    if (revalidate.valid())
+        revalidate.wait();
+}
+
+void CdmServer::FeedOrigins(std::vector<std::string>& origins) {
+    std::lock_guard<std::mutex> lock(airports_mutex_);
+    for (const auto& [icao, feed_url] : airports_) {
+        if (feed_url.empty())
+            continue;
+        std::string origin = HttpOrigin(feed_url);
+        if (std::find(origins.begin(), origins.end(), origin) == origins.end())
+            origins.push_back(std::move(origin));
+    }
+}
+
+void CdmServer::WriteAirports(std::ostream& f) {
+    std::lock_guard<std::mutex> lock(airports_mutex_);
+    if (airports_ts_ == 0)
+        return;
+
+    f << "server " << url_ << ' ' << airports_ts_ << ' ' << airports_.size() << '\n';
+    for (const auto& [icao, feed_url] : airports_)
+        f << icao << ' ' << (feed_url.empty() ? "-" : feed_url) << '\n';
+}
+
+bool CdmServer::RetrieveAirports() {
+    {
+        std::lock_guard<std::mutex> lock(airports_mutex_);
+        if (airports_ts_ > 0) {
+            bool running =
+                revalidate_.valid() && revalidate_.wait_for(std::chrono::seconds::zero()) != std::future_status::ready;
+            if (!running && Now() - airports_ts_ > airport_list_ttl) {
+                LogMsg("Airport list of '%s' expired, revalidating", name_.c_str());
+                revalidate_ = std::async(std::launch::async, [this]() {
+                    AirportList airports;
+                    if (DownloadAirports(airports)) {
+                        SetAirports(std::move(airports), Now());
+                        SaveAirportCache();
+                    }
+                });
+            }
+            return true;
+        }
+    }
+
+    AirportList airports;
+    if (!DownloadAirports(airports)) {
+        reachable_ = false;
+        return false;
+    }
+
+    SetAirports(std::move(airports), Now());
+    SaveAirportCache();
+    return true;
+}
+
+bool CdmServer::FindAirport(const std::string& icao, std::string& feed_url) {
+    if (!RetrieveAirports())
+        return false;
+
+    std::lock_guard<std::mutex> lock(airports_mutex_);
+    const auto it = airports_.find(icao);
+    if (it == airports_.end())
+        return false;
+
+    feed_url = it->second;
+    return true;
+}
+
+static void SaveAirportCache() {
+    if (airport_cache_path.empty())
+        return;
+
+    // write to a temp file and rename, the plugin may be stopped while a revalidation saves
+    std::lock_guard<std::mutex> lock(airport_cache_mutex);
+    const std::string tmp_path = airport_cache_path + ".tmp";
+    {
+        std::ofstream f(tmp_path, std::ios::trunc);
+        if (!f.is_open()) {
+            LogMsg("Can't create '%s'", tmp_path.c_str());
+            return;
+        }
+
+        f << "1\n";  // version
+        for (auto& s : cdm_servers)
+            s->WriteAirports(f);
+
+        if (!f.good()) {
+            LogMsg("Can't write '%s'", tmp_path.c_str());
+            return;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmp_path, airport_cache_path, ec);
+    if (ec)
+        LogMsg("Can't rename '%s': %s", tmp_path.c_str(), ec.message().c_str());
+}
+
 // extract HHMM from something like "2025-07-28T09:45:06.694Z"
 static std::string ExtractHHMM(const std::string& time) {
     if (time == "1969-12-31T23:59:59.999Z" || time.length() < 16)
@@ -180,27 +538,23 @@ static std::string ExtractHHMM(const std::string& time) {
 // RPuig implementation
 //
 
-// Load served airports
-// Attempts to retrieve the list of airports served by this server.
-// Returns true on success, false on failure. Retries up to kMaxRetries times before marking the server as dead.
-bool CdmServer_rpuig::RetrieveAirports() {
-    if (retrieved_)
-        return true;
-
+// Download served airports
+// Returns true on success, false on failure. On failure it's tried again with the next request the breaker lets pass.
+bool CdmServer_rpuig::DownloadAirports(AirportList& airports) {
     LogMsg("Loading airports for '%s' url: '%s'", name_.c_str(), url_.c_str());
 
     const std::string api_url = url_ + "/CDM_feeds.json";
 
-    json data_obj = GetJson(api_url);
+    json data_obj = FetchJson(api_url);
     if (data_obj.is_null()) {
-        LogMsg("Can't retrieve from '%s', retries left: %d", api_url.c_str(), --retries_left_);
+        LogMsg("Can't retrieve from '%s'", api_url.c_str());
         return false;
     }
 
     try {
         const auto& airport_obj = data_obj.at("airports");
         for (auto const& [icao, url_list] : airport_obj.items()) {
-            arpt_urls_[icao] = url_list[0].get<std::string>();
+            airports[icao] = url_list[0].get<std::string>();
             LogMsg("  '%s'", icao.c_str());
         }
     } catch (const std::exception& e) {
@@ -208,53 +562,74 @@ bool CdmServer_rpuig::RetrieveAirports() {
         return false;
     }
 
-    retrieved_ = true;
     return true;
 }
 
 // get and parse cdm data for airport/flight
 bool CdmServer_rpuig::CdmGetParse(const std::string& arpt_icao, const std::string& callsign, CdmInfo& cdm_info) {
-    if (is_dead())
+    std::string feed_url;
+    if (!FindAirport(arpt_icao, feed_url))
         return false;
 
-    if (!RetrieveAirports())
-        return false;
+    cdm_info.set_url(feed_url);
 
-    const auto it = arpt_urls_.find(arpt_icao);
-    if (it == arpt_urls_.end())
+    HttpBuffer buffer;
+    std::string& data = buffer.str();
+    if (!FetchRaw(feed_url, data, true)) {
+        if (NotModified())
+            return false;
+        cdm_info.set_status("Failed to retrieve CDM data");
         return false;
+    }
 
-    cdm_info.url = it->second;
+    // The feed holds all flights of the airport. Scan it in place for our callsign and only parse
+    // the matching flight object.
+    const char* end = data.data() + data.length();
+    std::string_view flight;
+    ForEachMember(SkipWs(data.data(), end), end, [&](std::string_view key, const char* v) -> const char* {
+        if (key != "flights")
+            return SkipValue(v, end);
+
+        ForEachElement(v, end, [&](const char* f) -> const char* {
+            bool match = false;
+            const char* f_end = ForEachMember(f, end, [&](std::string_view fkey, const char* fv) -> const char* {
+                const char* fv_end = SkipValue(fv, end);
+                if (fv_end && fkey == "callsign" && *fv == '"')
+                    match = std::string_view(fv + 1, fv_end - fv - 2) == callsign;
+                return fv_end;
+            });
+
+            if (match && f_end) {
+                flight = std::string_view(f, f_end - f);
+                return nullptr;  // found, stop
+            }
+            return f_end;
+        });
+        return nullptr;  // the rest is of no interest
+    });
 
-    json arpt_obj = GetJson(cdm_info.url);
-    if (arpt_obj.is_null()) {
-        cdm_info.status = "Failed to retrieve CDM data";
+    if (flight.empty()) {
+        LogMsg("flight '%s' not present on '%s'", callsign.c_str(), arpt_icao.c_str());
+        cdm_info.set_status("Flight not found");
         return false;
     }
 
     try {
-        const auto& flights = arpt_obj.at("flights").get<json>();
-        // LogMsgRaw(flights.dump(4));
-        for (const auto& f : flights) {
-            if (f.at("callsign").get<std::string>() == callsign) {
-                // LogMsgRaw(f.dump(4));
-#define EXTRACT(fn) cdm_info.fn = f.at(#fn).get<std::string>()
-                EXTRACT(tobt);
-                EXTRACT(tsat);
-                EXTRACT(runway);
-                EXTRACT(sid);
-                cdm_info.status = kSuccess;
-                LogMsg("CDM data for flight '%s' retrieved from '%s'", callsign.c_str(), cdm_info.url.c_str());
-                return true;
+        json f = json::parse(flight);
+#define EXTRACT(fn) cdm_info.set_##fn(f.at(#fn).get<std::string>())
+        EXTRACT(tobt);
+        EXTRACT(tsat);
+        EXTRACT(runway);
+        EXTRACT(sid);
 #undef EXTRACT
-            }
-        }
-        LogMsg("flight '%s' not present on '%s'", callsign.c_str(), arpt_icao.c_str());
+        cdm_info.set_status(kSuccess);
+        LogMsg("CDM data for flight '%s' retrieved from '%s'", callsign.c_str(), cdm_info.url().data());
+        return true;
     } catch (const std::exception& e) {
         LogMsg("Exception: '%s'", e.what());
     }
 
-    cdm_info.status = "Flight not found";
+    cdm_info.set_status("Flight not found");
     return false;
 }
 
@@ -263,14 +638,14 @@ bool CdmServer_rpuig::CdmGetParse(const std::string& arpt_icao, const std::strin
 //
 // get and parse cdm data for airport/flight
 bool CdmServer_viff::CdmGetParse(const std::string& arpt_icao, const std::string& callsign, CdmInfo& cdm_info) {
-    if (is_dead())
-        return false;
+    cdm_info.set_url(url_ + "/ifps/callsign?callsign=" + callsign);
 
-    cdm_info.url = url_ + "/ifps/callsign?callsign=" + callsign;
+    json flight_obj = FetchJson(std::string(cdm_info.url()), true);
+    if (NotModified())
+        return false;
 
-    json flight_obj = GetJson(cdm_info.url);
     if (flight_obj.is_null()) {
-        cdm_info.status = "Failed to retrieve CDM data";
+        cdm_info.set_status("Failed to retrieve CDM data");
         LogMsg("flight '%s' not present on vIFF server'%s'", callsign.c_str(), name().c_str());
         return false;
     }
@@ -278,7 +653,7 @@ bool CdmServer_viff::CdmGetParse(const std::string& arpt_icao, const std::string
     try {
         const auto& dep = flight_obj.at("departure").get<std::string>();
         if (dep != arpt_icao) {
-            cdm_info.status = "Flight not departing from this airport";
+            cdm_info.set_status("Flight not departing from this airport");
             LogMsg("flight '%s' departs from '%s', not from '%s'", callsign.c_str(), dep.c_str(), arpt_icao.c_str());
             return false;
         }
@@ -301,8 +676,8 @@ bool CdmServer_viff::CdmGetParse(const std::string& arpt_icao, const std::string
         //    "ttot": ""
         //}
 
-        cdm_info.tobt = cdm_obj.at("tobt").get<std::string>().substr(0, 4);
-        cdm_info.tsat = cdm_obj.at("tsat").get<std::string>().substr(0, 4);
+        cdm_info.set_tobt(cdm_obj.at("tobt").get<std::string>().substr(0, 4));
+        cdm_info.set_tsat(cdm_obj.at("tsat").get<std::string>().substr(0, 4));
 
         // "depInfo": "27L/TOLTA1F"
         std::string dep_info = cdm_obj.at("depInfo").get<std::string>();
@@ -313,31 +688,31 @@ bool CdmServer_viff::CdmGetParse(const std::string& arpt_icao, const std::string
         // servers should not be polled.
         // That's particularly important in the transtion phase where legacy servers are more often down than up.
 
-        if (cdm_info.tobt.empty() && cdm_info.tsat.empty() && dep_info.empty()) {
+        if (cdm_info.tobt().empty() && cdm_info.tsat().empty() && dep_info.empty()) {
             bool res = false;
             if (cdm_obj.at("confirmed").get<bool>()) {
-                cdm_info.status = "CDM data confirmed by pilot but not yet available";
+                cdm_info.set_status("CDM data confirmed by pilot but not yet available");
                 res = true;
             } else
-                cdm_info.status = "CDM data not available";
+                cdm_info.set_status("CDM data not available");
             LogMsg("CDM data for flight '%s' on vIFF server found but is empty", callsign.c_str());
             return res;
         }
 
         auto i = dep_info.find("/");
         if (i != std::string::npos) {
-            cdm_info.runway = dep_info.substr(0, i);
-            cdm_info.sid = dep_info.substr(i + 1);
+            cdm_info.set_runway(dep_info.substr(0, i));
+            cdm_info.set_sid(dep_info.substr(i + 1));
         }
 
-        cdm_info.status = kSuccess;
-        LogMsg("CDM data for flight '%s' retrieved from '%s'", callsign.c_str(), cdm_info.url.c_str());
+        cdm_info.set_status(kSuccess);
+        LogMsg("CDM data for flight '%s' retrieved from '%s'", callsign.c_str(), cdm_info.url().data());
         return true;
     } catch (const std::exception& e) {
         LogMsg("Exception: '%s'", e.what());
     }
 
-    cdm_info.status = "Flight not found";
+    cdm_info.set_status("Flight not found");
     return false;
 }
 
@@ -345,24 +720,21 @@ bool CdmServer_viff::CdmGetParse(const std::string& arpt_icao, const std::string
 //
 // vacdm implementation
 //
-bool CdmServer_vacdm::RetrieveAirports() {
-    if (retrieved_)
-        return true;
-
+bool CdmServer_vacdm::DownloadAirports(AirportList& airports) {
     LogMsg("Loading airports for '%s' url: '%s'", name_.c_str(), url_.c_str());
 
     std::string api_url = url_ + "/api/v1/airports";
 
-    json data_obj = GetJson(api_url);
+    json data_obj = FetchJson(api_url);
     if (data_obj.is_null()) {
-        LogMsg("Can't retrieve from '%s', retries left: %d", api_url.c_str(), --retries_left_);
+        LogMsg("Can't retrieve from '%s'", api_url.c_str());
         return false;
     }
 
     try {
         for (auto const& a : data_obj) {
             auto icao = a.at("icao").get<std::string>();
-            airports_[icao] = true;
+            airports[icao] = "";
             LogMsg("  '%s'", icao.c_str());
         }
     } catch (const std::exception& e) {
@@ -370,49 +742,45 @@ bool CdmServer_vacdm::RetrieveAirports() {
         return false;
     }
 
-    retrieved_ = true;
     return true;
 }
 
 // get and parse cdm data for airport/flight
 bool CdmServer_vacdm::CdmGetParse(const std::string& arpt_icao, const std::string& callsign, CdmInfo& cdm_info) {
-    if (is_dead())
-        return false;
-
-    if (!RetrieveAirports())
+    std::string feed_url;
+    if (!FindAirport(arpt_icao, feed_url))
         return false;
 
-    const auto it = airports_.find(arpt_icao);
-    if (it == airports_.end())
+    cdm_info.set_url(url_ + std::string("/api/v1/pilots/") + callsign);
+    json flight = FetchJson(std::string(cdm_info.url()), true);
+    if (NotModified())
         return false;
 
-    cdm_info.url = url_ + std::string("/api/v1/pilots/") + callsign;
-    json flight = GetJson(cdm_info.url);
     if (flight.is_null()) {
-        cdm_info.status = "Failed to retrieve CDM data";
+        cdm_info.set_status("Failed to retrieve CDM data");
         return false;
     }
 
     try {
         const auto& vacdm = flight.at("vacdm").get<json>();
-        cdm_info.tobt = ExtractHHMM(vacdm.at("tobt").get<std::string>());
-        cdm_info.tsat = ExtractHHMM(vacdm.at("tsat").get<std::string>());
+        cdm_info.set_tobt(ExtractHHMM(vacdm.at("tobt").get<std::string>()));
+        cdm_info.set_tsat(ExtractHHMM(vacdm.at("tsat").get<std::string>()));
         const auto& clearance = flight.at("clearance").get<json>();
-        cdm_info.runway = clearance.at("dep_rwy").get<std::string>();
-        cdm_info.sid = clearance.at("sid").get<std::string>();
-        cdm_info.status = kSuccess;
+        cdm_info.set_runway(clearance.at("dep_rwy").get<std::string>());
+        cdm_info.set_sid(clearance.at("sid").get<std::string>());
+        cdm_info.set_status(kSuccess);
         return true;
     } catch (const json::out_of_range& e) {
         LogMsg("JSON key not found: '%s'", e.what());
-        cdm_info.status = "Flight not found";
+        cdm_info.set_status("Flight not found");
     } catch (const std::exception& e) {
         LogMsg("Exception: '%s'", e.what());
-        cdm_info.status = e.what();
+        cdm_info.set_status(e.what());
     }
 
     LogMsg("flight '%s' not present on '%s'", callsign.c_str(), arpt_icao.c_str());
 
-    cdm_info.status = "Flight not found";
+    cdm_info.set_status("Flight not found");
     return false;
 }
 
@@ -420,8 +788,6 @@ bool CdmServer_vacdm::CdmGetParse(const std::string& arpt_icao, const std::strin
 // Global entry points
 //
 bool CdmInit(const std::string& cfg_path) {
-    cache.idx = -1;
-
     std::ifstream f(cfg_path);
     if (f.fail())
         return false;
@@ -445,6 +811,25 @@ bool CdmInit(const std::string& cfg_path) {
 
     try {
         json cfg = json::parse(content);
+        airport_list_ttl = cfg.value("airport_list_ttl_h", 24) * 3600;
+
+        if (cfg.contains("poll")) {
+            const auto& p = cfg.at("poll");
+#define POLL_CFG(f) poll_cfg.f = std::max(1, p.value(#f, poll_cfg.f))
+            POLL_CFG(fast_s);
+            POLL_CFG(default_s);
+            POLL_CFG(slow_s);
+            POLL_CFG(not_found_max_s);
+            POLL_CFG(near_min);
+            POLL_CFG(far_min);
+#undef POLL_CFG
+            poll_cfg.default_s = std::max(poll_cfg.default_s, poll_cfg.fast_s);
+            poll_cfg.slow_s = std::max(poll_cfg.slow_s, poll_cfg.default_s);
+            poll_cfg.far_min = std::max(poll_cfg.far_min, poll_cfg.near_min);
+            LogMsg("poll schedule: fast %d s, default %d s, slow %d s, not found up to %d s, near %d min, far %d min",
+                   poll_cfg.fast_s, poll_cfg.default_s, poll_cfg.slow_s, poll_cfg.not_found_max_s, poll_cfg.near_min,
+                   poll_cfg.far_min);
+        }
 
         for (const auto& s : cfg.at("servers").get<json::array_t>()) {
             const auto& name = s.at("name").get<std::string>();
@@ -474,32 +859,194 @@ bool CdmInit(const std::string& cfg_path) {
     return true;
 }
 
+bool CdmLoadAirportCache(const std::string& path) {
+    airport_cache_path = path;
+
+    std::ifstream f(path);
+    if (!f.is_open())
+        return false;
+
+    int version;
+    if (!(f >> version) || version != 1) {
+        LogMsg("Invalid airport cache '%s'", path.c_str());
+        return false;
+    }
+
+    std::string tag, url;
+    int ts;
+    size_t n;
+    while (f >> tag >> url >> ts >> n && tag == "server") {
+        AirportList airports;
+        std::string icao, feed_url;
+        for (size_t i = 0; i < n && f >> icao >> feed_url; i++)
+            airports[icao] = (feed_url == "-") ? "" : feed_url;
+
+        if (airports.size() != n) {
+            LogMsg("Truncated airport cache '%s'", path.c_str());
+            return false;
+        }
+
+        for (auto& s : cdm_servers)
+            if (s->url() == url) {
+                LogMsg("Airport list of '%s' loaded from cache, %d airports, age %d s", s->name().c_str(), (int)n,
+                       Now() - ts);
+                s->SetAirports(std::move(airports), ts);
+                break;
+            }
+    }
+
+    return true;
+}
+
+void CdmFini() {
+    for (auto& s : cdm_servers)
+        s->WaitRevalidate();
+
+    winners = decltype(winners)();
+    cdm_servers.clear();
+}
+
+std::vector<CdmServerStats> CdmGetServerStats() {
+    std::vector<CdmServerStats> stats;
+    for (const auto& s : cdm_servers)
+        stats.push_back({s->breaker().state(), s->breaker().next_probe()});
+    return stats;
+}
+
+std::vector<std::string> CdmGetServerUrls() {
+    std::vector<std::string> urls;
+    for (const auto& s : cdm_servers) {
+        std::string origin = HttpOrigin(s->url());
+        if (std::find(urls.begin(), urls.end(), origin) == urls.end())
+            urls.push_back(std::move(origin));
+    }
+
+    // e.g. the rpuig feeds are on hosts of their own
+    for (const auto& s : cdm_servers)
+        s->FeedOrigins(urls);
+    return urls;
+}
+
+// fill CdmInfo::times, HHMM values are placed on the day closest to now
+static void CdmSetTimes(CdmInfo& cdm_info) {
+    time_t now = time(nullptr);
+#define X(f) cdm_info.times.f.SetHHMM(cdm_info.f(), now);
+    CDM_TIMES(X)
+#undef X
+}
+
+int CdmPollDelay(const CdmInfo& cdm_info, int n_not_found, int& reason) {
+    const PollCfg& c = poll_cfg;
+
+    // the flight may show up later, e.g. after connecting to the network, but not within seconds
+    if (cdm_info.outcome == kCdmNotFound) {
+        reason = kCdmPollNotFound;
+        int n = std::clamp(n_not_found - 1, 0, 10);
+        return std::min(c.not_found_max_s, c.default_s << n);
+    }
+
+    // the circuit breakers pace the retries of servers that are down
+    if (cdm_info.outcome != kCdmFound) {
+        reason = kCdmPollError;
+        return c.default_s;
+    }
+
+    int ref = cdm_info.times.tsat.epoch ? cdm_info.times.tsat.epoch : cdm_info.times.tobt.epoch;
+    if (ref == 0) {
+        reason = kCdmPollNoData;
+        return c.slow_s;
+    }
+
+    // poll fast in the final minutes, including a TSAT that has passed and is likely to be updated.
+    // Slower polls end at the start of the next phase.
+    int dt = ref - Now();
+    int near = c.near_min * 60;
+    int far = c.far_min * 60;
+    if (dt <= near) {
+        reason = kCdmPollNear;
+        return c.fast_s;
+    }
+
+    if (dt <= far) {
+        reason = kCdmPollApproaching;
+        return std::clamp(dt - near, c.fast_s, c.default_s);
+    }
+
+    reason = kCdmPollFar;
+    return std::clamp(dt - far, c.default_s, c.slow_s);
+}
+
 // get and parse cdm data for airport/flight
 // *** runs in an async ***
 bool CdmGetParse(const std::string& arpt_icao, const std::string& callsign, std::unique_ptr<CdmInfo>& cdm_info) {
     cdm_info = std::make_unique<CdmInfo>();
-
-    if (cache.idx >= 0 && cache.arpt_icao == arpt_icao && cache.callsign == callsign) {
-        LogMsg("Cache hit for '%s' '%s' on server '%s'", arpt_icao.c_str(), callsign.c_str(), cdm_servers[cache.idx]->name().c_str());
-        return cdm_servers[cache.idx]->CdmGetParse(arpt_icao, callsign, *cdm_info);
+    const std::string key = arpt_icao + "/" + callsign;
+
+    const int* cached_idx = winners.Find(key);
+    if (cached_idx && cdm_servers[*cached_idx]->breaker().Allow()) {
+        auto& s = cdm_servers[*cached_idx];
+        LogMsg("Cache hit for '%s' '%s' on server '%s'", arpt_icao.c_str(), callsign.c_str(), s->name().c_str());
+        bool res = s->CachedGetParse(arpt_icao, callsign, *cdm_info);
+        s->breaker().Done();
+        cdm_info->outcome = res ? kCdmFound : s->reachable() ? kCdmNotFound : kCdmError;
+        CdmSetTimes(*cdm_info);
+        return res;
     }
 
-    for (auto i = 0; i < (int)cdm_servers.size(); i++) {
+    // Query all live servers concurrently but keep the priority of the config file:
+    // the result of server i is only taken when all servers before it have failed.
+    // So the latency is that of the slowest server up to the winner, not the sum of all.
+    const int n_servers = cdm_servers.size();
+    std::atomic<bool> cancel{false};
+    std::vector<std::unique_ptr<CdmInfo>> infos(n_servers);
+    std::vector<std::future<bool>> futures(n_servers);  // after infos and cancel, they are referenced
+
+    for (int i = 0; i < n_servers; i++) {
         auto& s = cdm_servers[i];
-        if (s->is_dead()) {
-            LogMsg("CdmServer '%s' is dead, skipping", s->name().c_str());
+        if (!s->breaker().Allow()) {
+            LogMsg("CdmServer '%s' is down, skipping", s->name().c_str());
             continue;
         }
 
-        if (s->CdmGetParse(arpt_icao, callsign, *cdm_info)) {
-            cache.idx = i;
-            cache.arpt_icao = arpt_icao;
-            cache.callsign = callsign;
-            return true;
+        infos[i] = std::make_unique<CdmInfo>();
+        futures[i] = std::async(std::launch::async, [&, i]() {
+            HttpSetCancel(&cancel);
+            bool res = cdm_servers[i]->CachedGetParse(arpt_icao, callsign, *infos[i]);
+            cdm_servers[i]->breaker().Done();
+            HttpSetCancel(nullptr);  // the thread may be pooled and cancel goes out of scope
+            return res;
+        });
+    }
+
+    int winner = -1;
+    for (int i = 0; i < n_servers; i++)
+        if (futures[i].valid() && futures[i].get()) {
+            winner = i;
+            break;
         }
+
+    // cancel the lower priority requests and wait for them to wind down
+    cancel = true;
+    futures.clear();
+
+    if (winner >= 0) {
+        LogMsg("CDM data for '%s' '%s' from server '%s'", arpt_icao.c_str(), callsign.c_str(),
+               cdm_servers[winner]->name().c_str());
+        cdm_info = std::move(infos[winner]);
+        cdm_info->outcome = kCdmFound;
+        winners.Insert(key, int(winner));
+        CdmSetTimes(*cdm_info);
+        return true;
     }
 
-    cdm_info->status = "Flight not found";
-    cache.idx = -1;
+    // not found if any server answered, an error if all that were asked failed or none was asked
+    bool answered = false;
+    for (int i = 0; i < n_servers; i++)
+        if (infos[i] && cdm_servers[i]->reachable())
+            answered = true;
+
+    cdm_info->outcome = answered ? kCdmNotFound : kCdmError;
+    cdm_info->set_status(answered ? "Flight not found" : "CDM servers not reachable");
+    winners.Erase(key);
     return false;
 }
@@ -0,0 +1,94 @@
+//
+//    Simbrief Hub: A central resource of simbrief data for other plugins
+//
+//    Copyright (C) 2025 Holger Teutsch
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Lesser General Public
+//    License as published by the Free Software Foundation; either
+//    version 2.1 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+//    USA
+//
+
+// Test of the cdm poll schedule CdmPollDelay() with the default configuration.
+// No network access required.
+//
+// call with
+// cdm_poll_test
+// exit status 0 = all checks passed
+//
+
+#include <ctime>
+#include <string>
+
+#include "sbh.h"
+
+const char* log_msg_prefix = "cdm_poll_test: ";
+
+static int n_failed;
+
+#define CHECK(cond)                                        \
+    do {                                                   \
+        if (!(cond)) {                                     \
+            LogMsg("FAILED line %d: %s", __LINE__, #cond); \
+            n_failed++;                                    \
+        }                                                  \
+    } while (0)
+
+// outcome with a TSAT dt s from now, dt = 0 for no times
+static CdmInfo Info(int outcome, int dt = 0) {
+    CdmInfo cdm_info;
+    cdm_info.outcome = outcome;
+    if (dt != 0)
+        cdm_info.times.tsat.Set(time(nullptr) + dt);
+    return cdm_info;
+}
+
+static int Delay(const CdmInfo& cdm_info, int n_not_found, int expected_reason) {
+    int reason = -1;
+    int delay = CdmPollDelay(cdm_info, n_not_found, reason);
+    LogMsg("outcome %d, tsat %d, n_not_found %d -> delay %d s, reason %d", cdm_info.outcome,
+           cdm_info.times.tsat.epoch, n_not_found, delay, reason);
+    CHECK(reason == expected_reason);
+    return delay;
+}
+
+int main() {
+    // not found backs off from the default interval to the limit
+    CHECK(Delay(Info(kCdmNotFound), 1, kCdmPollNotFound) == 90);
+    CHECK(Delay(Info(kCdmNotFound), 2, kCdmPollNotFound) == 180);
+    CHECK(Delay(Info(kCdmNotFound), 4, kCdmPollNotFound) == 600);
+    CHECK(Delay(Info(kCdmNotFound), 100, kCdmPollNotFound) == 600);
+
+    // servers down or network errors don't back off, whatever was not found before
+    CHECK(Delay(Info(kCdmError), 0, kCdmPollError) == 90);
+    CHECK(Delay(Info(kCdmError), 4, kCdmPollError) == 90);
+
+    // found, the TSAT sets the pace
+    CHECK(Delay(Info(kCdmFound), 0, kCdmPollNoData) == 300);
+    CHECK(Delay(Info(kCdmFound, 2 * 3600), 0, kCdmPollFar) == 300);
+    int d = Delay(Info(kCdmFound, 33 * 60), 0, kCdmPollFar);  // until the approach phase
+    CHECK(d >= 178 && d <= 180);
+    CHECK(Delay(Info(kCdmFound, 20 * 60), 0, kCdmPollApproaching) == 90);
+    d = Delay(Info(kCdmFound, 11 * 60), 0, kCdmPollApproaching);  // until the final minutes
+    CHECK(d >= 58 && d <= 60);
+    CHECK(Delay(Info(kCdmFound, 5 * 60), 0, kCdmPollNear) == 30);
+    CHECK(Delay(Info(kCdmFound, -5 * 60), 0, kCdmPollNear) == 30);  // passed, likely to be updated
+
+    if (n_failed) {
+        LogMsg("%d checks failed", n_failed);
+        return 1;
+    }
+
+    LogMsg("all checks passed");
+    return 0;
+}
@@ -0,0 +1,560 @@
+//
+//    Simbrief Hub: A central resource of simbrief data for other plugins
+//
+//    Copyright (C) 2026 Holger Teutsch
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Lesser General Public
+//    License as published by the Free Software Foundation; either
+//    version 2.1 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+//    USA
+//
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "http_fetch.h"
+#include "log_msg.h"
+
+static constexpr const char* kUserAgent = "simbrief_hub";
+
+static std::atomic<uint64_t> n_requests, n_failures, n_not_modified, n_wire_bytes, n_decoded_bytes;
+static std::atomic<uint64_t> n_connects_new, n_connects_reused;
+
+// Idle connections are closed after this. That covers the fast and default cdm polls (30 s, 90 s),
+// slower polls open a new connection but resume the TLS session. Servers may close sooner.
+static constexpr long kIdleTimeout = 120;  // s
+
+// buffer pools
+static constexpr struct {
+    size_t initial;       // reserved for a new buffer
+    size_t max_capacity;  // larger buffers are freed on return
+    size_t pool_size;     // buffers kept for reuse, more concurrent fetches allocate and free the surplus
+} kBufferClasses[HttpBuffer::kNumSizeClasses] = {
+    {0, 256 * 1024, 4},                 // kSmall
+    {300 * 1024, 8 * 1024 * 1024, 2},  // kLarge
+};
+
+static std::mutex pool_mutex;
+static std::vector<std::string> pool[HttpBuffer::kNumSizeClasses];
+static uint64_t n_buffer_reuses, buffer_peak;
+
+static thread_local const std::atomic<bool>* cancel_flag;
+
+void HttpSetCancel(const std::atomic<bool>* cancel) {
+    cancel_flag = cancel;
+}
+
+bool HttpCancelled() {
+    return cancel_flag && cancel_flag->load();
+}
+
+std::string HttpOrigin(const std::string& url) {
+    auto p = url.find("://");
+    p = (p == std::string::npos) ? 0 : p + 3;
+    return url.substr(0, url.find('/', p));
+}
+
+static bool StatusOk(long status, const HttpValidators* validators) {
+    return (status >= 200 && status < 300) || (validators && status == 304);
+}
+
+static void Account(bool ok, const HttpResult& res) {
+    n_requests++;
+    if (!ok && !res.cancelled)
+        n_failures++;
+    if (ok && res.status == 304)
+        n_not_modified++;
+    if (res.status != 0)
+        (res.new_connection ? n_connects_new : n_connects_reused)++;
+    n_wire_bytes += res.wire_bytes;
+    n_decoded_bytes += res.decoded_bytes;
+}
+
+HttpStats HttpGetStats() {
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    return HttpStats{n_requests,      n_failures,  n_not_modified, n_wire_bytes,     n_decoded_bytes,
+                     n_buffer_reuses, buffer_peak, n_connects_new, n_connects_reused};
+}
+
+HttpBuffer::HttpBuffer(SizeClass size_class) : size_class_(size_class) {
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        auto& p = pool[size_class_];
+        if (!p.empty()) {
+            buf_ = std::move(p.back());
+            p.pop_back();
+            // a buffer that lost its storage saves nothing
+            if (buf_.capacity() >= kBufferClasses[size_class_].initial) {
+                n_buffer_reuses++;
+                return;
+            }
+        }
+    }
+
+    buf_.reserve(kBufferClasses[size_class_].initial);
+}
+
+HttpBuffer::~HttpBuffer() {
+    buf_.clear();
+    const auto& bc = kBufferClasses[size_class_];
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    buffer_peak = std::max<uint64_t>(buffer_peak, buf_.capacity());
+    auto& p = pool[size_class_];
+    if (buf_.capacity() <= bc.max_capacity && p.size() < bc.pool_size)
+        p.push_back(std::move(buf_));
+}
+
+#ifdef IBM
+#include <windows.h>
+#include <winhttp.h>
+
+// not in all mingw headers
+#ifndef WINHTTP_OPTION_DECOMPRESSION
+#define WINHTTP_OPTION_DECOMPRESSION 118
+#endif
+#ifndef WINHTTP_DECOMPRESSION_FLAG_ALL
+#define WINHTTP_DECOMPRESSION_FLAG_ALL 0x00000003
+#endif
+#ifndef WINHTTP_OPTION_ENABLE_HTTP_PROTOCOL
+#define WINHTTP_OPTION_ENABLE_HTTP_PROTOCOL 133
+#endif
+#ifndef WINHTTP_PROTOCOL_FLAG_HTTP2
+#define WINHTTP_PROTOCOL_FLAG_HTTP2 0x1
+#endif
+
+// WinHTTP keeps a pool of keep-alive connections per session, so all fetches share one session.
+// The idle timeout of the pool is WinHTTP's own.
+static std::once_flag session_flag;
+static HINTERNET session;
+
+// context value of a request = pointer to HttpResult
+static void CALLBACK StatusCb(HINTERNET, DWORD_PTR context, DWORD status, LPVOID, DWORD) {
+    if (status == WINHTTP_CALLBACK_STATUS_CONNECTING_TO_SERVER && context)
+        reinterpret_cast<HttpResult*>(context)->new_connection = true;
+}
+
+static std::wstring Widen(const std::string& str) {
+    int len = MultiByteToWideChar(CP_UTF8, 0, str.c_str(), -1, NULL, 0);
+    std::wstring wstr(len, L'\0');
+    MultiByteToWideChar(CP_UTF8, 0, str.c_str(), -1, wstr.data(), len);
+    wstr.resize(len - 1);
+    return wstr;
+}
+
+static std::string Narrow(const std::wstring& wstr) {
+    int len = WideCharToMultiByte(CP_UTF8, 0, wstr.c_str(), -1, NULL, 0, NULL, NULL);
+    std::string str(len, '\0');
+    WideCharToMultiByte(CP_UTF8, 0, wstr.c_str(), -1, str.data(), len, NULL, NULL);
+    str.resize(len - 1);
+    return str;
+}
+
+// value of a response header or ""
+static std::string QueryHeader(HINTERNET request, DWORD info_level) {
+    DWORD size = 0;
+    WinHttpQueryHeaders(request, info_level, WINHTTP_HEADER_NAME_BY_INDEX, WINHTTP_NO_OUTPUT_BUFFER, &size,
+                        WINHTTP_NO_HEADER_INDEX);
+    if (GetLastError() != ERROR_INSUFFICIENT_BUFFER || size == 0)
+        return "";
+
+    std::wstring val(size / sizeof(wchar_t), L'\0');
+    if (!WinHttpQueryHeaders(request, info_level, WINHTTP_HEADER_NAME_BY_INDEX, val.data(), &size,
+                             WINHTTP_NO_HEADER_INDEX))
+        return "";
+    val.resize(size / sizeof(wchar_t));
+    return Narrow(val);
+}
+
+// head = HEAD request, e.g. to just open a connection
+static bool Fetch(const std::string& url, std::string& data, int timeout, HttpResult& res,
+                  const HttpValidators* validators, bool head = false) {
+    std::wstring wurl = Widen(url);
+
+    URL_COMPONENTS uc{};
+    uc.dwStructSize = sizeof(uc);
+    uc.dwHostNameLength = (DWORD)-1;
+    uc.dwUrlPathLength = (DWORD)-1;
+    uc.dwExtraInfoLength = (DWORD)-1;
+    if (!WinHttpCrackUrl(wurl.c_str(), 0, 0, &uc)) {
+        LogMsg("Invalid url '%s'", url.c_str());
+        return false;
+    }
+
+    std::wstring host(uc.lpszHostName, uc.dwHostNameLength);
+    std::wstring path(uc.lpszUrlPath, uc.dwUrlPathLength);
+    path.append(uc.lpszExtraInfo, uc.dwExtraInfoLength);
+
+    std::call_once(session_flag, []() {
+        session = WinHttpOpen(Widen(kUserAgent).c_str(), WINHTTP_ACCESS_TYPE_AUTOMATIC_PROXY, WINHTTP_NO_PROXY_NAME,
+                              WINHTTP_NO_PROXY_BYPASS, 0);
+        if (session == NULL)
+            return;
+
+        // HTTP/2 where the server and Windows support it, silently ignored otherwise
+        DWORD protocols = WINHTTP_PROTOCOL_FLAG_HTTP2;
+        WinHttpSetOption(session, WINHTTP_OPTION_ENABLE_HTTP_PROTOCOL, &protocols, sizeof(protocols));
+
+        // inherited by the connection and request handles
+        WinHttpSetStatusCallback(session, StatusCb, WINHTTP_CALLBACK_FLAG_CONNECT_TO_SERVER, 0);
+    });
+
+    bool ok = false;
+    HINTERNET connection = NULL, request = NULL;
+
+    // any failure breaks out of this block
+    do {
+        if (session == NULL)
+            break;
+
+        connection = WinHttpConnect(session, host.c_str(), uc.nPort, 0);
+        if (connection == NULL)
+            break;
+
+        request = WinHttpOpenRequest(connection, head ? L"HEAD" : L"GET", path.c_str(), NULL, WINHTTP_NO_REFERER,
+                                     WINHTTP_DEFAULT_ACCEPT_TYPES,
+                                     uc.nScheme == INTERNET_SCHEME_HTTPS ? WINHTTP_FLAG_SECURE : 0);
+        if (request == NULL)
+            break;
+
+        DWORD_PTR context = reinterpret_cast<DWORD_PTR>(&res);
+        WinHttpSetOption(request, WINHTTP_OPTION_CONTEXT_VALUE, &context, sizeof(context));
+
+        // let WinHTTP negotiate gzip/deflate and decompress on the fly
+        DWORD decompression = WINHTTP_DECOMPRESSION_FLAG_ALL;
+        WinHttpSetOption(request, WINHTTP_OPTION_DECOMPRESSION, &decompression, sizeof(decompression));
+
+        int tmo = timeout * 1000;
+        WinHttpSetTimeouts(request, tmo, tmo, tmo, tmo);
+
+        if (HttpCancelled()) {
+            res.cancelled = true;
+            break;
+        }
+
+        std::wstring headers;
+        if (validators) {
+            if (!validators->etag.empty())
+                headers += L"If-None-Match: " + Widen(validators->etag) + L"\r\n";
+            if (!validators->last_modified.empty())
+                headers += L"If-Modified-Since: " + Widen(validators->last_modified) + L"\r\n";
+        }
+
+        if (!WinHttpSendRequest(request, headers.empty() ? WINHTTP_NO_ADDITIONAL_HEADERS : headers.c_str(),
+                                (DWORD)headers.length(), WINHTTP_NO_REQUEST_DATA, 0, 0, 0) ||
+            !WinHttpReceiveResponse(request, NULL))
+            break;
+
+        DWORD status = 0, size = sizeof(status);
+        WinHttpQueryHeaders(request, WINHTTP_QUERY_STATUS_CODE | WINHTTP_QUERY_FLAG_NUMBER,
+                            WINHTTP_HEADER_NAME_BY_INDEX, &status, &size, WINHTTP_NO_HEADER_INDEX);
+        res.status = status;
+        res.validators.etag = QueryHeader(request, WINHTTP_QUERY_ETAG);
+        res.validators.last_modified = QueryHeader(request, WINHTTP_QUERY_LAST_MODIFIED);
+
+        // Content-Length is the compressed size, not present for chunked transfers
+        DWORD content_length = 0;
+        size = sizeof(content_length);
+        bool have_length =
+            WinHttpQueryHeaders(request, WINHTTP_QUERY_CONTENT_LENGTH | WINHTTP_QUERY_FLAG_NUMBER,
+                                WINHTTP_HEADER_NAME_BY_INDEX, &content_length, &size, WINHTTP_NO_HEADER_INDEX);
+
+        bool read_ok = true;
+        while (true) {
+            if (HttpCancelled()) {
+                res.cancelled = true;
+                read_ok = false;
+                break;
+            }
+
+            DWORD avail = 0;
+            if (!WinHttpQueryDataAvailable(request, &avail)) {
+                read_ok = false;
+                break;
+            }
+
+            if (avail == 0)
+                break;
+
+            size_t ofs = data.size();
+            data.resize(ofs + avail);
+            DWORD n_read = 0;
+            if (!WinHttpReadData(request, data.data() + ofs, avail, &n_read)) {
+                read_ok = false;
+                break;
+            }
+            data.resize(ofs + n_read);
+        }
+
+        res.decoded_bytes = data.size();
+        res.wire_bytes = have_length ? content_length : data.size();
+        ok = read_ok && StatusOk(status, validators);
+    } while (false);
+
+    if (!ok && res.status == 0 && !res.cancelled)
+        LogMsg("HttpFetch '%s' failed, error: %lu", url.c_str(), GetLastError());
+
+    if (request)
+        WinHttpCloseHandle(request);
+    if (connection)
+        WinHttpCloseHandle(connection);
+    return ok;
+}
+
+void HttpFini() {
+    if (session) {
+        WinHttpCloseHandle(session);  // closes the pooled connections
+        session = NULL;
+    }
+}
+
+#else
+#include <curl/curl.h>
+
+static std::once_flag curl_init_flag;
+
+// DNS cache and TLS sessions are shared by all easy handles.
+// curl does not support a shared connection cache for concurrent threads, so idle easy handles are kept
+// instead, each with its own connections. A fetch takes the handle that last talked to the same origin and
+// gets its keep-alive connection. A handle can move between threads as long as one uses it at a time.
+static CURLSH* share;
+static std::mutex share_mutex[CURL_LOCK_DATA_LAST];
+
+static constexpr size_t kMaxIdleHandles = 8;
+static std::mutex handle_mutex;
+static std::vector<std::pair<std::string, CURL*>> idle_handles;  // origin, handle; most recently used last
+
+static void ShareLock(CURL*, curl_lock_data data, curl_lock_access, void*) {
+    share_mutex[data].lock();
+}
+
+static void ShareUnlock(CURL*, curl_lock_data data, void*) {
+    share_mutex[data].unlock();
+}
+
+static void CurlInit() {
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    share = curl_share_init();
+    if (share == nullptr) {
+        LogMsg("curl_share_init() failed, DNS and TLS sessions are not shared");
+        return;
+    }
+
+    curl_share_setopt(share, CURLSHOPT_LOCKFUNC, ShareLock);
+    curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, ShareUnlock);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+}
+
+// an idle handle of origin with its options reset or a new one
+static CURL* AcquireHandle(const std::string& origin) {
+    {
+        std::lock_guard<std::mutex> lock(handle_mutex);
+        for (auto it = idle_handles.rbegin(); it != idle_handles.rend(); ++it)
+            if (it->first == origin) {
+                CURL* curl = it->second;
+                idle_handles.erase(std::next(it).base());
+                curl_easy_reset(curl);  // keeps connections, DNS and TLS session caches
+                return curl;
+            }
+    }
+
+    return curl_easy_init();
+}
+
+static void ReleaseHandle(const std::string& origin, CURL* curl) {
+    CURL* oldest = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(handle_mutex);
+        idle_handles.emplace_back(origin, curl);
+        if (idle_handles.size() > kMaxIdleHandles) {
+            oldest = idle_handles.front().second;
+            idle_handles.erase(idle_handles.begin());
+        }
+    }
+
+    if (oldest)
+        curl_easy_cleanup(oldest);  // closes its connections
+}
+
+static size_t WriteCb(char* ptr, size_t size, size_t nmemb, void* userdata) {
+    std::string& data = *static_cast<std::string*>(userdata);
+    data.append(ptr, size * nmemb);
+    return size * nmemb;
+}
+
+// collect the validators from the response headers
+static size_t HeaderCb(char* ptr, size_t size, size_t nmemb, void* userdata) {
+    HttpValidators& validators = *static_cast<HttpValidators*>(userdata);
+    size_t len = size * nmemb;
+    std::string_view line(ptr, len);
+
+    // a new response, e.g. after a redirect
+    if (line.starts_with("HTTP/")) {
+        validators = HttpValidators();
+        return len;
+    }
+
+    auto colon = line.find(':');
+    if (colon == std::string_view::npos)
+        return len;
+
+    auto name = line.substr(0, colon);
+    auto value = line.substr(colon + 1);
+    while (!value.empty() && (value.front() == ' ' || value.front() == '\t'))
+        value.remove_prefix(1);
+    while (!value.empty() && (value.back() == '\r' || value.back() == '\n' || value.back() == ' '))
+        value.remove_suffix(1);
+
+    auto IsHeader = [name](std::string_view h) {
+        return std::ranges::equal(name, h, [](char a, char b) { return std::tolower((unsigned char)a) == b; });
+    };
+
+    if (IsHeader("etag"))
+        validators.etag = value;
+    else if (IsHeader("last-modified"))
+        validators.last_modified = value;
+    return len;
+}
+
+// called by curl about once per second and on data, non zero aborts the transfer
+static int XferInfoCb(void*, curl_off_t, curl_off_t, curl_off_t, curl_off_t) {
+    return HttpCancelled() ? 1 : 0;
+}
+
+// head = HEAD request, e.g. to just open a connection
+static bool Fetch(const std::string& url, std::string& data, int timeout, HttpResult& res,
+                  const HttpValidators* validators, bool head = false) {
+    std::call_once(curl_init_flag, CurlInit);
+
+    const std::string origin = HttpOrigin(url);
+    CURL* curl = AcquireHandle(origin);
+    if (curl == nullptr) {
+        LogMsg("curl_easy_init() failed");
+        return false;
+    }
+
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl, CURLOPT_USERAGENT, kUserAgent);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);  // we run in threads
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    if (head)
+        curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, (long)timeout);
+    curl_easy_setopt(curl, CURLOPT_SHARE, share);
+    curl_easy_setopt(curl, CURLOPT_MAXAGE_CONN, kIdleTimeout);
+    curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_2TLS);  // HTTP/2 for https if offered
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCb);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &data);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, HeaderCb);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &res.validators);
+    if (cancel_flag) {
+        curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, XferInfoCb);
+        curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+    }
+
+    // "" = offer all encodings curl was built with, the body is decompressed as it streams in
+    curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+
+    struct curl_slist* headers = nullptr;
+    if (validators) {
+        if (!validators->etag.empty())
+            headers = curl_slist_append(headers, ("If-None-Match: " + validators->etag).c_str());
+        if (!validators->last_modified.empty())
+            headers = curl_slist_append(headers, ("If-Modified-Since: " + validators->last_modified).c_str());
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    }
+
+    CURLcode cc = curl_easy_perform(curl);
+    bool ok = false;
+    if (cc == CURLE_OK) {
+        curl_off_t wire_bytes = 0;
+        long n_connects = 0;
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &res.status);
+        curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &n_connects);
+        res.new_connection = n_connects > 0;
+        curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &wire_bytes);
+        res.wire_bytes = wire_bytes;
+        res.decoded_bytes = data.size();
+        ok = StatusOk(res.status, validators);
+    } else if (cc == CURLE_ABORTED_BY_CALLBACK)
+        res.cancelled = true;
+    else
+        LogMsg("HttpFetch '%s' failed: %s", url.c_str(), curl_easy_strerror(cc));
+
+    curl_slist_free_all(headers);
+    ReleaseHandle(origin, curl);
+    return ok;
+}
+
+void HttpFini() {
+    std::vector<std::pair<std::string, CURL*>> handles;
+    {
+        std::lock_guard<std::mutex> lock(handle_mutex);
+        handles.swap(idle_handles);
+    }
+
+    for (auto& [origin, curl] : handles)
+        curl_easy_cleanup(curl);  // closes its connections
+
+    if (share) {
+        CURLSHcode rc = curl_share_cleanup(share);
+        if (rc != CURLSHE_OK)
+            LogMsg("curl_share_cleanup() failed: %s", curl_share_strerror(rc));
+        share = nullptr;
+    }
+}
+#endif
+
+bool HttpFetch(const std::string& url, std::string& data, int timeout, HttpResult* result,
+               const HttpValidators* validators) {
+    HttpResult res;
+    data.clear();
+    bool ok = Fetch(url, data, timeout, res, validators);
+    if (res.cancelled)
+        LogMsg("HttpFetch '%s' cancelled", url.c_str());
+    else if (!ok && res.status != 0)
+        LogMsg("HttpFetch '%s': http status %ld", url.c_str(), res.status);
+
+    Account(ok, res);
+    if (result)
+        *result = res;
+    return ok;
+}
+
+void HttpPrewarm(const std::vector<std::string>& urls) {
+    std::vector<std::future<void>> futures;
+    for (const auto& url : urls)
+        futures.push_back(std::async(std::launch::async, [&url]() {
+            std::string data;
+            HttpResult res;
+            auto t0 = std::chrono::steady_clock::now();
+            Fetch(url, data, 5, res, nullptr, true);
+            int ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0).count();
+            if (res.status == 0) {
+                LogMsg("Prewarm of '%s' failed", url.c_str());
+                return;
+            }
+
+            // any status will do, the connection is open now
+            if (res.new_connection)
+                n_connects_new++;
+            LogMsg("Prewarm of '%s': %d ms, http status %ld", url.c_str(), ms, res.status);
+        }));
+}
@@ -0,0 +1,127 @@
+//
+//    Simbrief Hub: A central resource of simbrief data for other plugins
+//
+//    Copyright (C) 2026 Holger Teutsch
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Lesser General Public
+//    License as published by the Free Software Foundation; either
+//    version 2.1 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+//    USA
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Fetch layer used for simbrief and all cdm servers.
+// gzip/deflate is negotiated and the body is decompressed as a stream into the receive buffer.
+// Keep-alive connections are pooled and reused by later requests to the same host,
+// HTTP/2 is used where the server offers it.
+// curl: idle easy handles keep their connections for up to 2 min, DNS cache and TLS sessions are shared.
+// WinHTTP: one session for all requests.
+
+// Validators of a response, from the ETag and Last-Modified headers.
+// Passed back to HttpFetch() they are sent as If-None-Match and If-Modified-Since.
+struct HttpValidators {
+    std::string etag;
+    std::string last_modified;
+
+    bool empty() const {
+        return etag.empty() && last_modified.empty();
+    }
+};
+
+// per request information
+struct HttpResult {
+    long status{0};              // http status, 0 = no response
+    size_t wire_bytes{0};        // body bytes as transferred
+    size_t decoded_bytes{0};     // body bytes after decompression
+    bool cancelled{false};       // aborted by the cancel flag, not counted as failure
+    bool new_connection{false};  // false = a pooled keep-alive connection was reused
+    HttpValidators validators;   // of the response
+};
+
+// totals since startup
+struct HttpStats {
+    uint64_t requests;
+    uint64_t failures;
+    uint64_t not_modified;      // conditional requests answered with 304
+    uint64_t wire_bytes;
+    uint64_t decoded_bytes;
+    uint64_t buffer_reuses;     // HttpBuffer served from the pool
+    uint64_t buffer_peak;       // largest capacity of a returned buffer
+    uint64_t connects_new;      // requests that opened a connection
+    uint64_t connects_reused;   // requests that reused a keep-alive connection
+};
+
+// Receive buffer from small pools owned by the fetch layer, one per size class so the large OFP buffers
+// are not handed out for CDM responses.
+// The buffer is returned on destruction and keeps its capacity up to the limit of its class, so buffers grow
+// to the high-water mark and steady state fetching does no large allocations.
+// thread safe
+class HttpBuffer {
+   public:
+    enum SizeClass {
+        kSmall = 0,  // CDM responses
+        kLarge,      // OFPs
+        kNumSizeClasses
+    };
+
+   private:
+    std::string buf_;
+    SizeClass size_class_;
+
+   public:
+    explicit HttpBuffer(SizeClass size_class = kSmall);
+    ~HttpBuffer();
+    HttpBuffer(const HttpBuffer&) = delete;
+    HttpBuffer& operator=(const HttpBuffer&) = delete;
+
+    std::string& str() {
+        return buf_;
+    }
+};
+
+// GET url into data (data is cleared first)
+// With validators the request is conditional and a 304 "Not Modified" is a success with empty data.
+// returns true on http status 2xx or 304
+// thread safe
+extern bool HttpFetch(const std::string& url, std::string& data, int timeout, HttpResult* result = nullptr,
+                      const HttpValidators* validators = nullptr);
+
+extern HttpStats HttpGetStats();
+
+// "https://host:port" of url, the key of pooled connections
+extern std::string HttpOrigin(const std::string& url);
+
+// Resolve and open connections to the hosts of urls with a HEAD request each, concurrently.
+// Later fetches from these hosts reuse the connection while it is idle for less than 2 min,
+// with curl the TLS session can be resumed later on, too.
+// Returns when all are done, not counted as requests.
+// thread safe
+extern void HttpPrewarm(const std::vector<std::string>& urls);
+
+// Set the cancel flag for fetches of the calling thread, nullptr = none.
+// A running transfer is aborted soon after *cancel becomes true and HttpFetch() returns false.
+// With WinHTTP this is checked between the blocking calls only.
+extern void HttpSetCancel(const std::atomic<bool>* cancel);
+
+// true if the cancel flag of the calling thread is set
+extern bool HttpCancelled();
+
+// Close pooled connections and release curl handles or the WinHTTP session.
+// Call after the last fetch has finished, e.g. from XPluginStop().
+extern void HttpFini();
@@ -0,0 +1,154 @@
+//
+//    Simbrief Hub: A central resource of simbrief data for other plugins
+//
+//    Copyright (C) 2026 Holger Teutsch
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Lesser General Public
+//    License as published by the Free Software Foundation; either
+//    version 2.1 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+//    USA
+//
+
+#pragma once
+
+#include <cstring>
+#include <string_view>
+
+// Minimal json byte scanner for hot paths that need a few values out of a large document.
+// Values are skipped without validation, so the input must come from a trusted json producer.
+// All functions take [p, end) and return nullptr on malformed input.
+
+static inline const char* SkipWs(const char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+        p++;
+    return p;
+}
+
+// p points to the opening quote, returns pointer past the closing quote or nullptr
+static inline const char* SkipString(const char* p, const char* end) {
+    p++;
+    while (true) {
+        const char* q = static_cast<const char*>(memchr(p, '"', end - p));
+        if (q == nullptr)
+            return nullptr;
+
+        // an odd number of backslashes escapes the quote
+        const char* bs = q;
+        while (bs > p && bs[-1] == '\\')
+            bs--;
+        p = q + 1;
+        if (((q - bs) & 1) == 0)
+            return p;
+    }
+}
+
+// skip any json value without validating it, returns pointer past the value or nullptr
+static inline const char* SkipValue(const char* p, const char* end) {
+    if (p >= end)
+        return nullptr;
+
+    if (*p == '"')
+        return SkipString(p, end);
+
+    if (*p != '{' && *p != '[') {
+        const char* start = p;
+        while (p < end && *p != ',' && *p != '}' && *p != ']' && *p != ' ' && *p != '\n' && *p != '\r' && *p != '\t')
+            p++;
+        return p > start ? p : nullptr;  // an empty primitive is malformed, e.g. "[}"
+    }
+
+    int depth = 0;
+    while (p < end) {
+        switch (*p) {
+            case '"':
+                p = SkipString(p, end);
+                if (p == nullptr)
+                    return nullptr;
+                continue;
+            case '{':
+            case '[':
+                depth++;
+                break;
+            case '}':
+            case ']':
+                if (--depth == 0)
+                    return p + 1;
+                break;
+        }
+        p++;
+    }
+    return nullptr;
+}
+
+// Iterate over the members of the object at p and call f(key, value) for each.
+// f must return the pointer past the value, e.g. by SkipValue(), or nullptr to stop.
+// Returns pointer past the object or nullptr if malformed or stopped.
+template <typename F>
+static inline const char* ForEachMember(const char* p, const char* end, F&& f) {
+    if (p == end || *p != '{')
+        return nullptr;
+
+    p = SkipWs(p + 1, end);
+    while (p < end && *p != '}') {
+        if (*p != '"')
+            return nullptr;
+        const char* key = p + 1;
+        p = SkipString(p, end);
+        if (p == nullptr)
+            return nullptr;
+        std::string_view key_sv(key, p - 1 - key);
+
+        p = SkipWs(p, end);
+        if (p == end || *p != ':')
+            return nullptr;
+        p = SkipWs(p + 1, end);
+        if (p == end)
+            return nullptr;
+
+        const char* v = p;
+        p = f(key_sv, v);
+        if (p == nullptr || p <= v)  // no progress is malformed input
+            return nullptr;
+
+        p = SkipWs(p, end);
+        if (p < end && *p == ',')
+            p = SkipWs(p + 1, end);
+        else if (p < end && *p != '}')
+            return nullptr;
+    }
+
+    return p < end ? p + 1 : nullptr;
+}
+
+// same for the elements of an array, f(value)
+template <typename F>
+static inline const char* ForEachElement(const char* p, const char* end, F&& f) {
+    if (p == end || *p != '[')
+        return nullptr;
+
+    p = SkipWs(p + 1, end);
+    while (p < end && *p != ']') {
+        const char* v = p;
+        p = f(v);
+        if (p == nullptr || p <= v)  // no progress is malformed input, e.g. "[1 }"
+            return nullptr;
+
+        p = SkipWs(p, end);
+        if (p < end && *p == ',')
+            p = SkipWs(p + 1, end);
+        else if (p < end && *p != ']')
+            return nullptr;
+    }
+
+    return p < end ? p + 1 : nullptr;
+}
@@ -0,0 +1,179 @@
+//
+//    Simbrief Hub: A central resource of simbrief data for other plugins
+//
+//    Copyright (C) 2026 Holger Teutsch
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Lesser General Public
+//    License as published by the Free Software Foundation; either
+//    version 2.1 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+//    USA
+//
+
+// Offline benchmark of the parse half of OfpGetParse() over a directory of OFPs (*.json).
+// No network access or pilot id required.
+//
+// ofp_corpus/ contains synthetic OFPs in simbrief's json layout, generated by ofp_corpus/gen_corpus.py.
+// They cover a short hop, a long haul with a large navlog, alternate as array and dx_rmk as array (with lbs units).
+// Recorded OFPs can be dropped into the directory as well, redact userid and user_id.
+//
+// call with
+// ofp_bench [-n runs] corpus_dir
+//
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <new>
+
+#ifdef IBM
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "sbh.h"
+
+const char* log_msg_prefix = "ofp_bench: ";
+
+// heap accounting
+static size_t n_alloc, n_bytes;
+
+void* operator new(size_t size) {
+    n_alloc++;
+    n_bytes += size;
+    void* p = malloc(size);
+    if (p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    free(ptr);
+}
+
+// peak resident set size of the process in kB
+static long PeakRss() {
+#ifdef IBM
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+        return 0;
+    return pmc.PeakWorkingSetSize / 1024;
+#else
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru))
+        return 0;
+#if APL == 1
+    return ru.ru_maxrss / 1024;  // bytes on macOS
+#else
+    return ru.ru_maxrss;
+#endif
+#endif
+}
+
+static bool Bench(const std::filesystem::path& path, int runs) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f.is_open()) {
+        LogMsg("Can't open '%s'", path.string().c_str());
+        return false;
+    }
+
+    std::stringstream ss;
+    ss << f.rdbuf();
+    const std::string json_str = ss.str();
+
+    std::vector<double> times;  // us
+    times.reserve(runs);
+    size_t allocs = 0, bytes = 0;
+    int fixes = 0;
+
+    // run 0 is warm up
+    for (int i = 0; i <= runs; i++) {
+        size_t n0 = n_alloc;
+        size_t b0 = n_bytes;
+        auto t0 = std::chrono::steady_clock::now();
+
+        auto ofp_info = std::make_unique<OfpInfo>();
+        OfpFetchResult res = OfpParseResponse("123456", 0, json_str, *ofp_info);
+
+        auto t1 = std::chrono::steady_clock::now();
+        if (res != kFetchNew) {
+            LogMsg("%s: parse failed: '%s'", path.filename().string().c_str(), ofp_info->status().data());
+            return false;
+        }
+
+        if (i == 0)
+            continue;
+
+        times.push_back(std::chrono::duration<double, std::micro>(t1 - t0).count());
+        allocs = n_alloc - n0;
+        bytes = n_bytes - b0;
+        fixes = ofp_info->navlog.count();
+    }
+
+    std::sort(times.begin(), times.end());
+    auto Pct = [&](int p) { return times[std::min(runs - 1, runs * p / 100)]; };
+
+    double p50 = Pct(50);
+    LogMsg("%-24s %8d %5d %9.1f %9.1f %9.1f %9.1f %8.1f %7d %9d %8ld", path.filename().string().c_str(),
+           (int)json_str.length(), fixes, p50, Pct(90), Pct(99), times.back(), json_str.length() / p50, (int)allocs,
+           (int)bytes, PeakRss());
+    return true;
+}
+
+int main(int argc, char** argv) {
+    int runs = 200;
+    int i = 1;
+    if (argc > 2 && strcmp(argv[1], "-n") == 0) {
+        runs = std::max(1, atoi(argv[2]));
+        i = 3;
+    }
+
+    if (i >= argc) {
+        LogMsg("usage: ofp_bench [-n runs] corpus_dir");
+        exit(1);
+    }
+
+    std::vector<std::filesystem::path> files;
+    std::error_code ec;
+    for (const auto& de : std::filesystem::directory_iterator(argv[i], ec))
+        if (de.is_regular_file() && de.path().extension() == ".json")
+            files.push_back(de.path());
+
+    if (ec || files.empty()) {
+        LogMsg("no *.json files in '%s'", argv[i]);
+        exit(1);
+    }
+
+    std::sort(files.begin(), files.end());
+
+    LogMsg("%d runs per file, times in us, throughput in MB/s, allocations per parse, peak RSS in kB", runs);
+    LogMsg("%-24s %8s %5s %9s %9s %9s %9s %8s %7s %9s %8s", "file", "bytes", "fixes", "p50", "p90", "p99", "max",
+           "MB/s", "allocs", "alloc_b", "rss");
+
+    bool ok = true;
+    for (const auto& path : files)
+        ok &= Bench(path, runs);
+
+    exit(ok ? 0 : 1);
+}
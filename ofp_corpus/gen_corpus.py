@@ -0,0 +1,157 @@
+#
+#    Simbrief Hub: A central resource of simbrief data for other plugins
+#
+#    Copyright (C) 2026 Holger Teutsch
+#
+#    This library is free software; you can redistribute it and/or
+#    modify it under the terms of the GNU Lesser General Public
+#    License as published by the Free Software Foundation; either
+#    version 2.1 of the License, or (at your option) any later version.
+#
+#    This library is distributed in the hope that it will be useful,
+#    but WITHOUT ANY WARRANTY; without even the implied warranty of
+#    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+#    Lesser General Public License for more details.
+#
+#    You should have received a copy of the GNU Lesser General Public
+#    License along with this library; if not, write to the Free Software
+#    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+#    USA
+#
+
+# Generator of the synthetic OFPs in ofp_corpus/ for ofp_bench.
+# They follow simbrief's json layout and sizes but all values (idents, ids, times) are made up.
+# The random generator is seeded, so the output is reproducible.
+#
+# python gen_corpus.py ofp_corpus
+#
+
+import json, random, sys, os
+random.seed(42)
+
+def fix(i, n, lat0, lon0, lat1, lon1, cum_t, cum_fuel):
+    f = i / max(n - 1, 1)
+    lat = lat0 + (lat1 - lat0) * f
+    lon = lon0 + (lon1 - lon0) * f
+    stage = "CLB" if f < 0.1 else ("DSC" if f > 0.9 else "CRZ")
+    alt = int(min(1.0, f * 10, (1 - f) * 10) * 37000)
+    ident = "".join(random.choice("ABCDEFGHIJKLMNOPQRSTUVWXYZ") for _ in range(5))
+    return {
+        "ident": ident, "name": ident, "type": "wpt", "icao_region": "ED", "frequency": {},
+        "pos_lat": f"{lat:.6f}", "pos_long": f"{lon:.6f}", "stage": stage,
+        "via_airway": random.choice(["DCT", "UL607", "UN850", "Y163", "T161"]),
+        "is_sid_star": "1" if f < 0.05 or f > 0.95 else "0",
+        "distance": str(random.randint(5, 60)), "track_true": str(random.randint(0, 359)),
+        "track_mag": str(random.randint(0, 359)), "heading_true": str(random.randint(0, 359)),
+        "heading_mag": str(random.randint(0, 359)), "altitude_feet": str(alt),
+        "ind_airspeed": "280", "true_airspeed": "460", "mach": "0.78", "mach_thousandths": "780",
+        "wind_component": str(random.randint(-60, 60)), "groundspeed": "470",
+        "time_leg": str(random.randint(60, 600)), "time_total": str(cum_t),
+        "fuel_flow": "2400", "fuel_leg": "150", "fuel_totalused": str(cum_fuel),
+        "fuel_min_onboard": "9000", "fuel_plan_onboard": str(max(0, 60000 - cum_fuel)),
+        "oat": "-45", "oat_isa_dev": "5", "wind_dir": "270", "wind_spd": "45", "shear": "2",
+        "tropopause_feet": "36000", "ground_height": "1200", "mora": "4300", "fir": "EDGG",
+        "fir_units": "N", "fir_valid_levels": "0-999",
+        "wind_data": {"level": [{"altitude": str(a), "wind_dir": str(random.randint(0, 359)),
+                                 "wind_spd": str(random.randint(0, 120)), "oat": str(-a // 700)}
+                                for a in range(2000, 42000, 4000)]},
+        "fir_crossing": {},
+    }
+
+def airport(icao, iata, lat, lon, rwy):
+    return {
+        "icao_code": icao, "iata_code": iata, "faa_code": {}, "icao_region": icao[:2], "elevation": "364",
+        "pos_lat": f"{lat:.6f}", "pos_long": f"{lon:.6f}", "name": icao + " INTL", "timezone": "1",
+        "plan_rwy": rwy, "trans_alt": "5000", "trans_level": "7000",
+        "metar": f"{icao} 281020Z 24008KT 9999 FEW030 18/09 Q1017 NOSIG", "metar_time": "2025-07-28T10:20:00Z",
+        "metar_category": "VFR", "metar_visibility": "10000", "metar_ceiling": "3000",
+        "taf": f"TAF {icao} 280500Z 2806/2912 24010KT 9999 SCT035 BECMG 2814/2816 27012KT",
+        "taf_time": "2025-07-28T05:00:00Z", "atis": [],
+        "notam": [{"source_id": "DFS", "account_id": icao, "notam_id": f"A{1000+i}/25",
+                   "location_id": icao, "location_icao": icao, "location_name": icao + " INTL",
+                   "notam_text": "TWY N BTN N4 AND N6 CLSD DUE TO WIP. " * 4, "notam_nrc": "A",
+                   "notam_qcode": "QMXLC"} for i in range(30)],
+    }
+
+def ofp(n_fix, orig, dest, altn, dx_rmk, alt_array=False, units="kgs"):
+    cum_t, cum_fuel = 0, 0
+    fixes = []
+    for i in range(n_fix):
+        cum_t += random.randint(60, 600)
+        cum_fuel += random.randint(50, 300)
+        fixes.append(fix(i, n_fix, orig[2], orig[3], dest[2], dest[3], cum_t, cum_fuel))
+    route = " ".join(f["ident"] + " " + f["via_airway"] for f in fixes[1:-1])
+    alts = [airport(a[0], a[1], a[2], a[3], a[4]) | {"route": "DCT " + a[0][2:] + "VOR DCT"} for a in altn]
+    out = 1753690000
+    d = {
+        "fetch": {"userid": "123456", "static_id": {}, "status": "Success", "time": "0.0231"},
+        "params": {"request_id": str(random.randint(10**8, 10**9)), "sequence_id": "abc", "static_id": {},
+                   "user_id": "123456", "time_generated": str(out - 3600), "xml_file": "x.xml",
+                   "ofp_layout": "LIDO", "airac": "2507", "units": units},
+        "general": {"release": "1", "icao_airline": "DLH", "flight_number": "400", "is_etops": "0",
+                    "dx_rmk": dx_rmk, "sys_rmk": {}, "is_detailed_profile": "1", "cruise_profile": "CI 30",
+                    "costindex": "30", "initial_altitude": "35000", "stepclimb_string": "EDDF/0350",
+                    "avg_temp_dev": "-3", "avg_tropopause": "36150", "avg_wind_comp": "-45",
+                    "avg_wind_dir": "270", "avg_wind_spd": "50", "gc_distance": "3500", "route_distance": "3620",
+                    "air_distance": "3700", "total_burn": str(cum_fuel), "cruise_tas": "470", "cruise_mach": "0.78",
+                    "passengers": "160", "route": route, "route_ifps": "N0460F350 " + route,
+                    "route_navigraph": route, "sid_ident": "TOBAK7F", "sid_trans": {}, "star_ident": "ROKI2A",
+                    "star_trans": {}},
+        "origin": airport(*orig),
+        "destination": airport(*dest),
+        "alternate": alts if alt_array else (alts[0] if alts else {}),
+        "takeoff_altn": {}, "enroute_altn": {},
+        "navlog": {"fix": fixes},
+        "etops": {},
+        "atc": {"flightplan_text": "(FPL-DLH400-IS\n-A320/M-SDE2E3FGHIJ1RWXY/LB1\n-" + orig[0] + "0900\n-N0460F350 " + route + ")",
+                "route": route, "callsign": "DLH400", "initial_spd": "0460", "initial_alt": "350"},
+        "aircraft": {"icaocode": "A320", "iatacode": "320", "base_type": "A320", "icao_code": "A320",
+                     "iata_code": "320", "name": "A320-200", "reg": "D-AIZA", "fin": {}, "selcal": {},
+                     "equip": "SDE2E3FGHIJ1RWXY", "fuelfact": "P00", "fuelfactor": "0", "max_passengers": "180",
+                     "supports_tlr": "1"},
+        "fuel": {"taxi": "200", "enroute_burn": str(cum_fuel), "contingency": "300", "alternate_burn": "1200",
+                 "reserve": "1100", "etops": "0", "extra": "0", "min_takeoff": "6000", "plan_takeoff": "6500",
+                 "plan_ramp": "6700", "plan_landing": "4200", "avg_fuel_flow": "2400", "max_tanks": "18700"},
+        "times": {"est_time_enroute": str(cum_t), "sched_time_enroute": str(cum_t), "sched_out": str(out),
+                  "sched_off": str(out + 900), "sched_on": str(out + 900 + cum_t), "sched_in": str(out + 1200 + cum_t),
+                  "est_out": str(out), "est_off": str(out + 900), "est_on": str(out + 900 + cum_t),
+                  "est_in": str(out + 1200 + cum_t), "est_block": str(cum_t + 1200), "orig_timezone": "2",
+                  "dest_timezone": "2", "taxi_out": "900", "taxi_in": "300", "reserve_time": "1800"},
+        "weights": {"oew": "42600", "pax_count": "160", "bag_count": "160", "pax_count_actual": "160",
+                    "pax_weight": "84", "bag_weight": "20", "freight_added": "2000", "cargo": "5200",
+                    "payload": "17100", "est_zfw": "59700", "max_zfw": "62500", "est_tow": "66200",
+                    "max_tow": "77000", "max_tow_struct": "77000", "tow_limit_code": "S", "est_ldw": "62100",
+                    "max_ldw": "66000"},
+        "impacts": {"minus_6000ft": {"time_enroute": "3900", "burn_difference": "400"}},
+        "crew": {"pilot_id": "123456", "cpt": "JOHN DOE", "fo": "JANE DOE", "dx": "DISPATCHER"},
+        "notams": {"notamdrec": [{"notam_id": f"B{i}/25", "notam_text": "OBST CRANE ERECTED " * 6} for i in range(n_fix // 4)]},
+        "weather": {"orig_metar": "METAR", "orig_taf": "TAF", "dest_metar": "METAR", "dest_taf": "TAF",
+                    "altn_metar": "METAR", "altn_taf": "TAF"},
+        "sigmets": {"sigmet": [{"fir": "EDGG", "text": "SEV TURB FCST " * 10} for _ in range(5)]},
+        "text": {"cache_time": "0", "plan_html": "<div><pre>" + ("DLH400 EDDF-XXXX LIDO PLAN LINE " * 40 + "\n") * 60 + "</pre></div>"},
+        "tracks": {},
+        "files": {"directory": "https://www.simbrief.com/ofp/flightplans/",
+                  "pdf": {"name": "ofp.pdf", "link": "ofp.pdf"}, "file": [{"name": "x", "link": "y"}] * 20},
+        "links": {"skyvector": "https://skyvector.com/?chart=304&fpl=" + route.replace(" ", "%20")},
+        "vatsim_prefile": "https://my.vatsim.net/pilots/flightplan?raw=" + route,
+        "tlr": {"takeoff": {"conditions": {"airport_icao": orig[0], "planned_runway": orig[4],
+                                           "flap_setting": "CONF 1+F", "surface_condition": "dry"},
+                            "runway": [{"identifier": orig[4], "length": "13123", "speeds_v1": "143"}]}},
+    }
+    return d
+
+cases = {
+    "short_hop.json": dict(n_fix=22, orig=("EDDF", "FRA", 50.03, 8.57, "25C"), dest=("EDDM", "MUC", 48.35, 11.78, "26R"),
+                           altn=[("EDDN", "NUE", 49.49, 11.07, "28")], dx_rmk="CREW REQUESTED EXTRA FUEL"),
+    "long_haul.json": dict(n_fix=480, orig=("EDDF", "FRA", 50.03, 8.57, "25C"), dest=("KSFO", "SFO", 37.61, -122.37, "28L"),
+                           altn=[("KOAK", "OAK", 37.72, -122.22, "30")], dx_rmk="ETOPS NOT REQUIRED"),
+    "alternate_array.json": dict(n_fix=40, orig=("LEMD", "MAD", 40.47, -3.56, "36L"), dest=("LFPG", "CDG", 49.00, 2.55, "27R"),
+                                 altn=[("LFPO", "ORY", 48.72, 2.38, "06"), ("LFOB", "BVA", 49.45, 2.11, "12")],
+                                 dx_rmk="", alt_array=True),
+    "dx_rmk_array.json": dict(n_fix=35, orig=("EGLL", "LHR", 51.47, -0.45, "27R"), dest=("LOWW", "VIE", 48.11, 16.57, "29"),
+                              altn=[], dx_rmk=["WX AT DEST MARGINAL", "TANKERING NOT ECONOMIC", "PAX VIP ON BOARD"], units="lbs"),
+}
+os.makedirs(sys.argv[1], exist_ok=True)
+for fn, kw in cases.items():
+    with open(os.path.join(sys.argv[1], fn), "w") as f:
+        json.dump(ofp(**kw), f, separators=(",", ":"))
@@ -19,23 +19,32 @@
 //    USA
 //
 
+#include <cctype>
 #include <cstdlib>
 #include <cstdio>
 #include <cstring>
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <charconv>
+#include <algorithm>
+#include <fstream>
+#include <filesystem>
+#include <chrono>
 
 #define JSON_USE_IMPLICIT_CONVERSIONS 0
 #include "nlohmann/json.hpp"
 using json = nlohmann::json;
 
 #include "sbh.h"
-#include "http_get.h"
+#include "http_fetch.h"
+#include "json_scan.h"
 
 static int seqno;
 
 void OfpInfo::Dump() const {
-    if (status == "Success") {
-#define L(field) LogMsg(#field ": %s", field.c_str())
+    if (status() == kSuccess) {
+#define L(field) LogMsg(#field ": %s", field().data())
         L(units);
         L(icao_airline);
         L(flight_number);
@@ -67,145 +76,1014 @@ void OfpInfo::Dump() const {
         L(max_zfw);
         L(max_tow);
         L(dx_rmk);
+        LogMsg("navlog: %d fixes", navlog.count());
     } else
-        LogMsg("%s", status.c_str());
+        LogMsg("%s", status().data());
 #undef L
 }
 
-// extract string if defined, undefined fields are a null object {}
-static void Extract(const json& field, std::string& str) {
-    if (field.is_string())
-        str = field.get<std::string>();
+// The SimBrief payload is large (navlog, notams, weather, plan_html, ...) but we only need a few dozen strings.
+// So instead of building a DOM the top level object is split with a cheap byte scanner and only the sections
+// below are run through a SAX parser that picks the fields. Everything else is skipped without allocation.
+enum OfpSection { kFetch, kParams, kAircraft, kFuel, kOrigin, kDestination, kGeneral, kAlternate, kWeights, kTimes };
+
+static constexpr const char* kSectionNames[] = {"fetch",       "params",  "aircraft",  "fuel",    "origin",
+                                                "destination", "general", "alternate", "weights", "times"};
+
+static const struct {
+    OfpSection section;
+    const char* key;
+    OfpField field;
+} kOfpFields[] = {
+    {kFetch, "status", OfpField::status},
+    {kParams, "time_generated", OfpField::time_generated},
+    {kParams, "units", OfpField::units},
+    {kAircraft, "icaocode", OfpField::aircraft_icao},
+    {kAircraft, "max_passengers", OfpField::max_passengers},
+    {kFuel, "plan_ramp", OfpField::fuel_plan_ramp},
+    {kFuel, "taxi", OfpField::fuel_taxi},
+    {kOrigin, "icao_code", OfpField::origin},
+    {kOrigin, "plan_rwy", OfpField::origin_rwy},
+    {kDestination, "icao_code", OfpField::destination},
+    {kDestination, "plan_rwy", OfpField::destination_rwy},
+    {kGeneral, "icao_airline", OfpField::icao_airline},
+    {kGeneral, "flight_number", OfpField::flight_number},
+    {kGeneral, "costindex", OfpField::ci},
+    {kGeneral, "initial_altitude", OfpField::altitude},
+    {kGeneral, "avg_tropopause", OfpField::tropopause},
+    {kGeneral, "avg_wind_comp", OfpField::wind_component},
+    {kGeneral, "avg_temp_dev", OfpField::isa_dev},
+    {kGeneral, "route", OfpField::route},
+    {kGeneral, "sid_ident", OfpField::sid},
+    {kGeneral, "dx_rmk", OfpField::dx_rmk},  // string or array of strings
+    {kAlternate, "icao_code", OfpField::alternate},  // alternate is an object, an array of objects or empty
+    {kAlternate, "route", OfpField::alt_route},
+    {kWeights, "oew", OfpField::oew},
+    {kWeights, "pax_count", OfpField::pax_count},
+    {kWeights, "freight_added", OfpField::freight},
+    {kWeights, "payload", OfpField::payload},
+    {kWeights, "max_zfw", OfpField::max_zfw},
+    {kWeights, "max_tow", OfpField::max_tow},
+    {kTimes, "est_time_enroute", OfpField::est_time_enroute},
+    {kTimes, "est_out", OfpField::est_out},
+    {kTimes, "est_off", OfpField::est_off},
+    {kTimes, "est_on", OfpField::est_on},
+    {kTimes, "est_in", OfpField::est_in},
+};
+
+static constexpr int kNumOfpFields = sizeof(kOfpFields) / sizeof(kOfpFields[0]);
+static_assert(kNumOfpFields <= 64, "seen mask is a uint64_t");
+
+class OfpSax : public json::json_sax_t {
+    OfpInfo& ofp_info_;
+    int section_{-1};         // section currently parsed
+    int depth_{0};            // nesting level of objects and arrays within the section
+    int field_depth_{0};      // depth where keys are fields of section_, 0 = none
+    int field_{-1};           // index into kOfpFields awaiting its value
+    bool alt_array_{false};   // alternate is an array, only the first entry is used
+    int alt_entries_{0};
+    bool alt_present_{false};
+    bool in_dx_rmk_{false};   // inside the dx_rmk array
+
+   public:
+    uint64_t seen_{0};        // bit i = kOfpFields[i] was found
+    std::string error_;
+
+    explicit OfpSax(OfpInfo& ofp_info) : ofp_info_(ofp_info) {}
+
+    // prepare for parsing the value of a top level key
+    void Section(int section) {
+        section_ = section;
+        depth_ = field_depth_ = 0;
+        field_ = -1;
+        alt_array_ = in_dx_rmk_ = false;
+    }
+
+    // check that all mandatory fields are present
+    bool Complete() {
+        for (int i = 0; i < kNumOfpFields; i++) {
+            if (seen_ & (1ULL << i))
+                continue;
+            if (kOfpFields[i].section == kAlternate && !alt_present_)
+                continue;  // no alternate airport
+            error_ = std::string(kSectionNames[kOfpFields[i].section]) + "." + kOfpFields[i].key + " not found";
+            return false;
+        }
+        return true;
+    }
+
+    bool null() override {
+        return Scalar();
+    }
+
+    bool boolean(bool) override {
+        return Scalar();
+    }
+
+    bool number_integer(number_integer_t) override {
+        return Scalar();
+    }
+
+    bool number_unsigned(number_unsigned_t) override {
+        return Scalar();
+    }
+
+    bool number_float(number_float_t, const string_t&) override {
+        return Scalar();
+    }
+
+    bool binary(binary_t&) override {
+        return Scalar();
+    }
+
+    bool string(string_t& val) override {
+        if (field_ < 0)
+            return true;
+
+        int f = (int)kOfpFields[field_].field;
+        if (in_dx_rmk_) {
+            // concatenate array entries with space
+            if (depth_ == field_depth_ + 1) {
+                if (!ofp_info_.fields.get(f).empty())
+                    ofp_info_.fields.Append(f, " ");
+                ofp_info_.fields.Append(f, val);
+            }
+            return true;
+        }
+
+        ofp_info_.fields.Set(f, val);
+        field_ = -1;
+        return true;
+    }
+
+    bool start_object(std::size_t) override {
+        depth_++;
+        if (depth_ == 1 && !alt_array_)
+            field_depth_ = 1;
+        else if (depth_ == 2 && alt_array_ && alt_entries_++ == 0)
+            field_depth_ = 2;
+
+        if (!in_dx_rmk_)
+            field_ = -1;  // undefined fields are an empty object {}
+        return true;
+    }
+
+    bool end_object() override {
+        if (depth_ == field_depth_)
+            field_depth_ = 0;
+        depth_--;
+        return true;
+    }
+
+    bool start_array(std::size_t) override {
+        depth_++;
+        if (depth_ == 1 && section_ == kAlternate)
+            alt_array_ = true;
+        else if (field_ >= 0 && depth_ == field_depth_ + 1 && kOfpFields[field_].field == OfpField::dx_rmk)
+            in_dx_rmk_ = true;
+        else if (!in_dx_rmk_)
+            field_ = -1;
+        return true;
+    }
+
+    bool end_array() override {
+        if (in_dx_rmk_ && depth_ == field_depth_ + 1) {
+            in_dx_rmk_ = false;
+            field_ = -1;
+        }
+        if (depth_ == 1)
+            alt_array_ = false;
+        depth_--;
+        return true;
+    }
+
+    bool key(string_t& val) override {
+        field_ = -1;
+        if (depth_ != field_depth_)
+            return true;
+
+        if (section_ == kAlternate)
+            alt_present_ = true;
+
+        for (int i = 0; i < kNumOfpFields; i++)
+            if (kOfpFields[i].section == section_ && val == kOfpFields[i].key) {
+                field_ = i;
+                seen_ |= 1ULL << i;
+                break;
+            }
+        return true;
+    }
+
+    bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& ex) override {
+        error_ = ex.what();
+        return false;
+    }
+
+   private:
+    bool Scalar() {
+        if (!in_dx_rmk_)
+            field_ = -1;
+        return true;
+    }
+};
+
+int Navlog::Intern(std::string_view str) {
+    uint64_t h = Fnv1a(str);
+    auto it = index.find(h);
+    if (it != index.end() && str == idents.c_str() + it->second)
+        return it->second;
+
+    int ofs = idents.length();
+    idents.append(str);
+    idents.push_back('\0');
+    if (it == index.end())  // on a collision the string is just not shared
+        index[h] = ofs;
+    return ofs;
+}
+
+// append a fix, identical idents share their storage
+void Navlog::AddFix(std::string_view ident, float lat_, float lon_, float altitude_, float distance_, float ete_,
+                    float fuel_) {
+    ident_ofs.push_back(Intern(ident));
+    lat.push_back(lat_);
+    lon.push_back(lon_);
+    altitude.push_back(altitude_);
+    distance.push_back(distance_);
+    ete.push_back(ete_);
+    fuel.push_back(fuel_);
+}
+
+// Extract navlog.fix, an array of fixes or a single fix.
+// Each fix carries lots of data (e.g. wind_data for all levels), so only the few values we need are picked
+// by the byte scanner. They are plain strings without escapes.
+// Returns pointer past the navlog or nullptr.
+// p < end
+static const char* NavlogScan(const char* p, const char* end, Navlog& navlog) {
+    enum FixKey { kIdent, kLat, kLon, kAltitude, kDistance, kTimeTotal, kFuelOnboard, kNumFixKeys };
+    static constexpr const char* kFixKeys[kNumFixKeys] = {
+        "ident", "pos_lat", "pos_long", "altitude_feet", "distance", "time_total", "fuel_plan_onboard"};
+
+    // a navlog of unexpected type (e.g. [] or "" for an empty one) leaves the navlog empty
+    if (*p != '{')
+        return SkipValue(p, end);
+
+    navlog.ident_ofs.reserve(256);
+    float cum_distance = 0.0f;
+
+    auto fix = [&](const char* v) -> const char* {
+        if (*v != '{')
+            return SkipValue(v, end);
+
+        std::string_view ident;
+        float val[kNumFixKeys]{};
+        const char* v_end = ForEachMember(v, end, [&](std::string_view key, const char* kv) {
+            const char* kv_end = SkipValue(kv, end);
+            if (kv_end == nullptr || *kv != '"')
+                return kv_end;  // undefined values are {}
+
+            const char* str = kv + 1;
+            const char* str_end = kv_end - 1;
+            for (int i = 0; i < kNumFixKeys; i++)
+                if (key == kFixKeys[i]) {
+                    if (i == kIdent)
+                        ident = std::string_view(str, str_end - str);
+                    else
+                        std::from_chars(str, str_end, val[i]);
+                    break;
+                }
+            return kv_end;
+        });
+
+        if (v_end == nullptr)
+            return nullptr;
+
+        cum_distance += val[kDistance];  // distance is per leg
+        navlog.AddFix(ident, val[kLat], val[kLon], val[kAltitude], cum_distance, val[kTimeTotal], val[kFuelOnboard]);
+        return v_end;
+    };
+
+    return ForEachMember(p, end, [&](std::string_view key, const char* v) -> const char* {
+        if (key != "fix")
+            return SkipValue(v, end);
+        if (*v == '[')
+            return ForEachElement(v, end, fix);
+        return fix(v);
+    });
+}
+
+// split the top level object and run the sections of interest through the SAX parser
+static bool OfpScan(const std::string& json_str, OfpSax& sax, Navlog& navlog) {
+    const char* p = json_str.data();
+    const char* end = p + json_str.length();
+
+    p = SkipWs(p, end);
+    bool ok = ForEachMember(p, end, [&](std::string_view key, const char* val) -> const char* {
+        if (key == "navlog") {
+            const char* val_end = NavlogScan(val, end, navlog);
+            if (val_end == nullptr)
+                sax.error_ = "malformed navlog";
+            return val_end;
+        }
+
+        const char* val_end = SkipValue(val, end);
+        if (val_end == nullptr)
+            return nullptr;
+
+        for (int i = 0; i < (int)std::size(kSectionNames); i++)
+            if (key == kSectionNames[i]) {
+                sax.Section(i);
+                if (!json::sax_parse(val, val_end, &sax))
+                    return nullptr;
+                break;
+            }
+        return val_end;
+    }) != nullptr;
+
+    if (!ok && sax.error_.empty())
+        sax.error_ = "malformed top level object";
+    return ok;
+}
+
+// for debugging, log the received json without userid
+static void LogOfpJson(const std::string& json_str) {
+    try {
+        json data_obj = json::parse(json_str);
+        data_obj["fetch"]["userid"] = "xxx";
+        data_obj["user_id"] = "xxx";
+        LogMsgRaw(data_obj.dump(4));
+    } catch (const std::exception& e) {
+        LogMsg("Can't dump json: %s", e.what());
+    }
+}
+
+bool OfpParse(const std::string& json_str, OfpInfo& ofp_info) {
+    OfpSax sax(ofp_info);
+    if (!OfpScan(json_str, sax, ofp_info.navlog)) {
+        LogMsg("Invalid json: %s", sax.error_.c_str());
+        ofp_info.set_status("Invalid JSON data");
+        ofp_info.stale = true;
+        return false;
+    }
+
+    if (ofp_info.status().empty()) {
+        LogMsg("error during JSON parsing: 'fetch.status not found'");
+        ofp_info.set_status("Invalid JSON data");
+        ofp_info.stale = true;
+        return false;
+    }
+
+    if (ofp_info.status() != kSuccess) {
+        ofp_info.stale = true;
+        return false;
+    }
+
+    // we only use mandatory fields, so missing ones are fatal
+    if (!sax.Complete()) {
+        LogMsg("error during JSON parsing: '%s'", sax.error_.c_str());
+        ofp_info.set_status("Invalid JSON data");
+        ofp_info.stale = true;
+        LogOfpJson(json_str);
+        return false;
+    }
+
+    ofp_info.stale = false;
+    return true;
+}
+
+// parse a leading number, a '+' sign is accepted, 0 if there is none
+template <typename T>
+static T ToNum(std::string_view str) {
+    if (!str.empty() && str[0] == '+')
+        str.remove_prefix(1);
+
+    T val{0};
+    std::from_chars(str.data(), str.data() + str.size(), val);
+    return val;
+}
+
+// two digits of v in 0..99, no terminator
+static void Put2(char* p, int v) {
+    p[0] = '0' + v / 10;
+    p[1] = '0' + v % 10;
+}
+
+// fill OfpInfo::num from the string fields
+static void OfpParseNum(OfpInfo& ofp_info) {
+    OfpNum& num = ofp_info.num;
+#define X(f) num.f = ToNum<int>(ofp_info.f());
+    OFP_INT_FIELDS(X)
+#undef X
+
+    float factor = (ofp_info.units() == "lbs") ? 0.45359237f : 1.0f;  // -> kg
+#define X(f) num.f = ToNum<float>(ofp_info.f()) * factor;
+    OFP_FLOAT_FIELDS(X)
+#undef X
+
+    OfpTimes& times = ofp_info.times;
+    times = OfpTimes();
+    times.generated.Set(num.time_generated);
+    times.out.Set(num.est_out);
+    times.off.Set(num.est_off);
+    times.on.Set(num.est_on);
+    times.in.Set(num.est_in);
+
+    if (num.est_out > 0 && num.est_in >= num.est_out)
+        times.block_mins = (num.est_in - num.est_out + 30) / 60;
+
+    if (!ofp_info.est_time_enroute().empty() && num.est_time_enroute >= 0) {
+        times.trip_mins = (num.est_time_enroute + 30) / 60;
+        int h = std::min(times.trip_mins / 60, 99);
+        int m = times.trip_mins >= 100 * 60 ? 59 : times.trip_mins % 60;
+        Put2(times.trip_hhmm, h);
+        Put2(times.trip_hhmm + 2, m);
+    }
+
+    if (num.time_generated > 0) {
+        using namespace std::chrono;
+        sys_seconds tp{seconds{num.time_generated}};
+        auto day = floor<days>(tp);
+        year_month_day ymd{day};
+        hh_mm_ss hms{tp - day};
+        // "YYYY-MM-DD HH:MM:SS", an int epoch can't go beyond 2038
+        char* p = times.generated_utc;
+        int y = (int)ymd.year();
+        Put2(p, y / 100);
+        Put2(p + 2, y % 100);
+        p[4] = p[7] = '-';
+        Put2(p + 5, (unsigned)ymd.month());
+        Put2(p + 8, (unsigned)ymd.day());
+        p[10] = ' ';
+        Put2(p + 11, hms.hours().count());
+        p[13] = p[16] = ':';
+        Put2(p + 14, hms.minutes().count());
+        Put2(p + 17, hms.seconds().count());
+        p[19] = '\0';
+    }
+}
+
+// SID/STAR designators are 2-5 letters, a digit and an optional letter, e.g. TOBAK7F, ROKI2A
+static bool IsSidStar(std::string_view tok) {
+    size_t n = 0;
+    while (n < tok.length() && isupper((unsigned char)tok[n]))
+        n++;
+    if (n < 2 || n > 5 || n == tok.length() || !isdigit((unsigned char)tok[n]))
+        return false;
+    tok.remove_prefix(n + 1);
+    return tok.empty() || (tok.length() == 1 && isupper((unsigned char)tok[0]));
+}
+
+// airways are 1-3 letters and 1-4 digits, e.g. UL607, Y163, T161
+static bool IsAirway(std::string_view tok) {
+    size_t n = 0;
+    while (n < tok.length() && isupper((unsigned char)tok[n]))
+        n++;
+    if (n < 1 || n > 3 || tok.length() - n < 1 || tok.length() - n > 4)
+        return false;
+    return std::all_of(tok.begin() + n, tok.end(), [](char c) { return isdigit((unsigned char)c); });
+}
+
+static void Tokenize(std::string_view route, Navlog& navlog, RouteTokens& tokens) {
+    tokens = RouteTokens();
+    while (true) {
+        size_t b = route.find_first_not_of(" \t\r\n");
+        if (b == std::string_view::npos)
+            break;
+        route.remove_prefix(b);
+        size_t e = std::min(route.find_first_of(" \t\r\n"), route.length());
+        std::string_view tok = route.substr(0, e);
+        route.remove_prefix(e);
+
+        RouteTokenType type = kTokenFix;
+        if (tok == "DCT")
+            type = kTokenDct;
+        else if (IsSidStar(tok))
+            type = kTokenSidStar;
+        else if (IsAirway(tok))
+            type = kTokenAirway;
+
+        tokens.ofs.push_back(navlog.Intern(tok));
+        tokens.type.push_back(type);
+    }
+}
+
+// fill OfpInfo::route_tokens and alt_route_tokens, requires the navlog
+static void OfpTokenizeRoutes(OfpInfo& ofp_info) {
+    Tokenize(ofp_info.route(), ofp_info.navlog, ofp_info.route_tokens);
+    Tokenize(ofp_info.alt_route(), ofp_info.navlog, ofp_info.alt_route_tokens);
+}
+
+// Find the string value of "key" within [p, end), the key must be unique in that range.
+static std::string_view FindStringValue(const char* p, const char* end, std::string_view key) {
+    std::string_view range(p, end - p);
+    size_t i = range.find(key);
+    if (i == std::string_view::npos)
+        return {};
+
+    const char* v = SkipWs(p + i + key.length(), end);
+    if (v == end || *v != ':')
+        return {};
+    v = SkipWs(v + 1, end);
+    if (v == end || *v != '"')
+        return {};
+
+    const char* v_end = SkipString(v, end);
+    if (v_end == nullptr)
+        return {};
+    return std::string_view(v + 1, v_end - 1 - (v + 1));
+}
+
+// Cheap fingerprint of an OFP that does not require parsing.
+// A plan is identified by params.request_id and params.time_generated. The raw payload can't be used
+// as fetch.time changes with every request. If the ids are missing the whole payload is hashed.
+static uint64_t OfpHash(const std::string& pilot_id, const std::string& json_str) {
+    uint64_t h = Fnv1a(pilot_id);
+
+    const char* p = json_str.data();
+    const char* end = p + json_str.length();
+    size_t i = json_str.find("\"params\"");
+    if (i != std::string::npos) {
+        const char* params = SkipWs(p + i + 8, end);
+        if (params < end && *params == ':') {
+            params = SkipWs(params + 1, end);
+            const char* params_end = SkipValue(params, end);
+            if (params_end) {
+                auto request_id = FindStringValue(params, params_end, "\"request_id\"");
+                auto time_generated = FindStringValue(params, params_end, "\"time_generated\"");
+                if (!request_id.empty() && !time_generated.empty())
+                    return Fnv1a(time_generated, Fnv1a(request_id, h));
+            }
+        }
+    }
+
+    return Fnv1a(json_str, h);
+}
+
+// Evaluate a json pointer (RFC 6901, e.g. "/tlr/takeoff/conditions/flap_setting") on the raw OFP.
+// The raw bytes are walked by the byte scanner, nothing but the result is materialized.
+// Strings are returned unescaped, any other value as its json text.
+// Returns false if the path does not exist.
+bool OfpQuery(const OfpInfo& ofp_info, std::string_view pointer, std::string& value) {
+    const char* p = ofp_info.raw.data();
+    const char* end = p + ofp_info.raw.size();
+    p = SkipWs(p, end);
+
+    std::string token;
+    while (!pointer.empty()) {
+        if (pointer[0] != '/')
+            return false;
+
+        pointer.remove_prefix(1);
+        size_t n = std::min(pointer.find('/'), pointer.size());
+        token.clear();
+        for (size_t i = 0; i < n; i++) {
+            if (pointer[i] == '~' && i + 1 < n && (pointer[i + 1] == '0' || pointer[i + 1] == '1')) {
+                token += (pointer[i + 1] == '0') ? '~' : '/';
+                i++;
+            } else
+                token += pointer[i];
+        }
+        pointer.remove_prefix(n);
+
+        const char* found = nullptr;
+        if (p < end && *p == '{') {
+            ForEachMember(p, end, [&](std::string_view key, const char* v) -> const char* {
+                if (key == token) {
+                    found = v;
+                    return nullptr;  // stop
+                }
+                return SkipValue(v, end);
+            });
+        } else if (p < end && *p == '[') {
+            int idx = -1;
+            auto [ptr, ec] = std::from_chars(token.data(), token.data() + token.size(), idx);
+            if (ec != std::errc() || ptr != token.data() + token.size() || idx < 0)
+                return false;
+
+            int i = 0;
+            ForEachElement(p, end, [&](const char* v) -> const char* {
+                if (i++ == idx) {
+                    found = v;
+                    return nullptr;  // stop
+                }
+                return SkipValue(v, end);
+            });
+        }
+
+        if (found == nullptr)
+            return false;
+        p = found;
+    }
+
+    const char* v_end = SkipValue(p, end);
+    if (v_end == nullptr)
+        return false;
+
+    if (*p != '"') {
+        value.assign(p, v_end);
+        return true;
+    }
+
+    try {
+        value = json::parse(p, v_end).get<std::string>();
+    } catch (const std::exception& e) {
+        LogMsg("OfpQuery: %s", e.what());
+        return false;
+    }
+    return true;
+}
+
+// The parse half of OfpGetParse(), seqno is not touched.
+// *** runs in an async ***
+OfpFetchResult OfpParseResponse(const std::string& pilot_id, uint64_t active_hash, const std::string& json_str,
+                                OfpInfo& ofp_info) {
+    uint64_t hash = OfpHash(pilot_id, json_str);
+    if (active_hash != 0 && hash == active_hash) {
+        ofp_info.set_status(kSuccess);
+        ofp_info.raw = json_str;  // for an active OFP without raw (from the snapshot)
+        return kFetchUnchanged;
+    }
+
+    // the hash is only valid for an OFP that parsed
+    if (!OfpParse(json_str, ofp_info))
+        return kFetchFailed;
+
+    ofp_info.hash = hash;
+
+    OfpParseNum(ofp_info);
+    OfpTokenizeRoutes(ofp_info);
+    ofp_info.num.altitude /= 100;  // -> FL
+    ofp_info.set_altitude(std::to_string(ofp_info.num.altitude));
+    ofp_info.raw = json_str;  // a copy, json_str is the pooled receive buffer and keeps its capacity
+    return kFetchNew;
 }
 
-bool OfpGetParse(const std::string& pilot_id, std::unique_ptr<OfpInfo>& ofp_info) {
-    std::string url = "https://www.simbrief.com/api/xml.fetcher.php?userid=" + pilot_id + "&json=1";
+// *** runs in an async ***
+OfpFetchResult OfpGetParse(const std::string& pilot_id, uint64_t active_hash, std::unique_ptr<OfpInfo>& ofp_info) {
+    std::string url = std::string(kSimbriefUrl) + "/api/xml.fetcher.php?userid=" + pilot_id + "&json=1";
     // LogMsg("%s", url);
 
     ofp_info = std::make_unique<OfpInfo>();
+    ofp_info->pilot_id = pilot_id;
 
-    std::string json_str;
-    json_str.reserve(300 * 1024);
-    bool res = HttpGet(url, json_str, 10);
+    HttpBuffer buffer(HttpBuffer::kLarge);
+    std::string& json_str = buffer.str();
+    HttpResult http_res;
+    bool res = HttpFetch(url, json_str, 10, &http_res);
 
     if (!res) {
-        ofp_info->status = "Network error";
+        ofp_info->set_status("Network error");
         ofp_info->stale = true;
+        return kFetchFailed;
+    }
+
+    LogMsg("got ofp json %d bytes, %d on the wire", (int)http_res.decoded_bytes, (int)http_res.wire_bytes);
+    OfpFetchResult fr = OfpParseResponse(pilot_id, active_hash, json_str, *ofp_info);
+    if (fr == kFetchUnchanged)
+        LogMsg("OFP is unchanged");
+    if (fr != kFetchNew)
+        return fr;
+
+    ofp_info->seqno = ++seqno;
+    LogMsg("OfpGetParse() success, seqno %d", ofp_info->seqno);
+    return kFetchNew;
+}
+
+//
+// Snapshot of the last good OFP so consumers have data right at startup
+//
+// Format:
+//  sbh_ofp <version>
+//  <pilot_id>
+//  <time_generated>
+//  <hash>
+//  followed by a record for each field:
+//  <field> <length>
+//  <value>
+//  and finally the navlog:
+//  navlog <count>
+//  <ident length> <ident> <lat> <lon> <altitude> <distance> <ete> <fuel>
+//  ...
+//
+static constexpr const char* kSnapshotMagic = "sbh_ofp";
+static constexpr int kSnapshotVersion = 6;
+
+static const struct {
+    const char* name;
+    OfpField field;
+} kSnapshotFields[] = {
+#define F(f) {#f, OfpField::f},
+    OFP_FIELDS(F)
+#undef F
+};
+
+// *** runs in an async ***
+bool OfpSaveSnapshot(const std::string& path, const std::string& pilot_id, const OfpInfo& ofp_info) {
+    // write to a temp file and rename so a crash never leaves a truncated snapshot
+    const std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream f(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!f.is_open()) {
+            LogMsg("Can't create '%s'", tmp_path.c_str());
+            return false;
+        }
+
+        f << kSnapshotMagic << ' ' << kSnapshotVersion << '\n'
+          << pilot_id << '\n'
+          << ofp_info.time_generated() << '\n'
+          << ofp_info.hash << '\n';
+        for (const auto& sf : kSnapshotFields) {
+            std::string_view val = ofp_info.fields.get((int)sf.field);
+            f << sf.name << ' ' << val.length() << '\n' << val << '\n';
+        }
+
+        // raw is left out, it's large and holds the user id. The confirming fetch provides it.
+
+        const Navlog& nl = ofp_info.navlog;
+        f << "navlog " << nl.count() << '\n';
+        f.precision(9);
+        for (int i = 0; i < nl.count(); i++) {
+            // length prefixed, an ident may be empty
+            std::string_view ident(nl.idents.c_str() + nl.ident_ofs[i]);
+            f << ident.length() << ' ' << ident << ' ' << nl.lat[i] << ' ' << nl.lon[i] << ' ' << nl.altitude[i]
+              << ' ' << nl.distance[i] << ' ' << nl.ete[i] << ' ' << nl.fuel[i] << '\n';
+        }
+
+        if (!f.good()) {
+            LogMsg("Can't write '%s'", tmp_path.c_str());
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmp_path, path, ec);
+    if (ec) {
+        LogMsg("Can't rename '%s': %s", tmp_path.c_str(), ec.message().c_str());
         return false;
     }
 
-    LogMsg("got ofp json %d bytes", (int)json_str.length());
-    json data_obj;
-    try {
-        data_obj = json::parse(json_str);
-        //LogMsgRaw(data_obj.dump(4));
-    } catch (const std::exception& e) {
-        LogMsg("Invalid json from '%s': %s", url.c_str(), e.what());
-        ofp_info->status = "Invalid JSON data";
-        ofp_info->stale = true;
+    return true;
+}
+
+bool OfpLoadSnapshot(const std::string& path, const std::string& pilot_id, std::unique_ptr<OfpInfo>& ofp_info) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f.is_open())
+        return false;
+
+    std::string magic, snap_pilot_id, time_generated;
+    int version = 0;
+    uint64_t hash = 0;
+    f >> magic >> version;
+    f.ignore(1);
+    std::getline(f, snap_pilot_id);
+    std::getline(f, time_generated);
+    f >> hash;
+    if (!f.good() || magic != kSnapshotMagic || version != kSnapshotVersion) {
+        LogMsg("Invalid snapshot '%s'", path.c_str());
         return false;
     }
 
-    // we only use mandatory fields, so exceptions are fatal
-    try {
-        ofp_info->status = data_obj.at("fetch").at("status").get<std::string>();
-        if (ofp_info->status != "Success") {
-            ofp_info->stale = true;
+    if (snap_pilot_id != pilot_id) {
+        LogMsg("Snapshot is for a different pilot_id, ignored");
+        return false;
+    }
+
+    // lengths and counts beyond the end of the file are corrupt, don't allocate for them
+    std::error_code ec;
+    const uint64_t file_size = std::filesystem::file_size(path, ec);
+    if (ec) {
+        LogMsg("Can't stat '%s': %s", path.c_str(), ec.message().c_str());
+        return false;
+    }
+
+    auto info = std::make_unique<OfpInfo>();
+    std::string name;
+    size_t len;
+    while (f >> name >> len) {
+        auto pos = f.tellg();
+        if (pos < 0 || len > file_size - (uint64_t)pos) {
+            LogMsg("Corrupt snapshot '%s'", path.c_str());
             return false;
         }
 
+        if (name == "navlog") {
+            std::string ident;
+            size_t ident_len;
+            float lat, lon, altitude, distance, ete, fuel;
+            for (size_t i = 0; i < len && f >> ident_len && ident_len < 64; i++) {  // idents are short
+                ident.resize(ident_len);
+                f.ignore(1);
+                f.read(ident.data(), ident_len);
+                if (!(f >> lat >> lon >> altitude >> distance >> ete >> fuel))
+                    break;
+                info->navlog.AddFix(ident, lat, lon, altitude, distance, ete, fuel);
+            }
+            if (info->navlog.count() != (int)len) {
+                LogMsg("Truncated snapshot '%s'", path.c_str());
+                return false;
+            }
+            continue;
+        }
+
+        f.ignore(1);
+        std::string val(len, '\0');
+        f.read(val.data(), len);
+        f.ignore(1);
+        if (!f.good()) {
+            LogMsg("Truncated snapshot '%s'", path.c_str());
+            return false;
+        }
+
+        for (const auto& sf : kSnapshotFields)
+            if (name == sf.name) {
+                info->fields.Set((int)sf.field, val);
+                break;
+            }
+    }
+
+    if (info->status() != kSuccess || info->time_generated() != time_generated) {
+        LogMsg("Invalid snapshot '%s'", path.c_str());
+        return false;
+    }
+
+    OfpParseNum(*info);  // altitude is saved as FL
+    OfpTokenizeRoutes(*info);
+    info->hash = hash;
+    info->stale = true;  // until the live fetch confirms it
+    info->pilot_id = pilot_id;
+    info->seqno = ++seqno;
+    ofp_info = std::move(info);
+    LogMsg("OFP snapshot generated at %s loaded, seqno %d", time_generated.c_str(), ofp_info->seqno);
+    return true;
+}
+
+#ifdef TEST_OFP_PARSE
+#include <ctime>
+#include <chrono>
+#include <sstream>
+#include <new>
+
+const char* log_msg_prefix = "ofp_get_parse_test: ";
+
+// crude heap accounting to compare the SAX with the DOM parser
+static size_t n_alloc, n_bytes;
+
+void* operator new(size_t size) {
+    n_alloc++;
+    n_bytes += size;
+    void* p = malloc(size);
+    if (p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    free(ptr);
+}
+
+// extract string if defined, undefined fields are a null object {}
+static void Extract(const json& field, OfpInfo& ofp_info, OfpField f) {
+    if (field.is_string())
+        ofp_info.fields.Set((int)f, field.get<std::string>());
+}
+
+// the former DOM based parser, kept as reference for the SAX parser
+static bool OfpParseDom(const std::string& json_str, OfpInfo& ofp_info) {
+    try {
+        json data_obj = json::parse(json_str);
+        ofp_info.set_status(data_obj.at("fetch").at("status").get<std::string>());
+        if (ofp_info.status() != "Success")
+            return false;
+
         const auto& params = data_obj.at("params");
-        Extract(params.at("time_generated"), ofp_info->time_generated);
-        Extract(params.at("units"), ofp_info->units);
+        Extract(params.at("time_generated"), ofp_info, OfpField::time_generated);
+        Extract(params.at("units"), ofp_info, OfpField::units);
 
         const auto& aircraft = data_obj.at("aircraft");
-        Extract(aircraft.at("icaocode"), ofp_info->aircraft_icao);
-        Extract(aircraft.at("max_passengers"), ofp_info->max_passengers);
+        Extract(aircraft.at("icaocode"), ofp_info, OfpField::aircraft_icao);
+        Extract(aircraft.at("max_passengers"), ofp_info, OfpField::max_passengers);
 
         const auto& fuel = data_obj.at("fuel");
-        Extract(fuel.at("plan_ramp"), ofp_info->fuel_plan_ramp);
-        Extract(fuel.at("taxi"), ofp_info->fuel_taxi);
+        Extract(fuel.at("plan_ramp"), ofp_info, OfpField::fuel_plan_ramp);
+        Extract(fuel.at("taxi"), ofp_info, OfpField::fuel_taxi);
         const auto& origin = data_obj.at("origin");
-        Extract(origin.at("icao_code"), ofp_info->origin);
-        Extract(origin.at("plan_rwy"), ofp_info->origin_rwy);
+        Extract(origin.at("icao_code"), ofp_info, OfpField::origin);
+        Extract(origin.at("plan_rwy"), ofp_info, OfpField::origin_rwy);
 
         const auto& destination = data_obj.at("destination");
-        Extract(destination.at("icao_code"), ofp_info->destination);
-        Extract(destination.at("plan_rwy"), ofp_info->destination_rwy);
+        Extract(destination.at("icao_code"), ofp_info, OfpField::destination);
+        Extract(destination.at("plan_rwy"), ofp_info, OfpField::destination_rwy);
 
         const auto& general = data_obj.at("general");
-        Extract(general.at("icao_airline"), ofp_info->icao_airline);
-        Extract(general.at("flight_number"), ofp_info->flight_number);
-        Extract(general.at("costindex"), ofp_info->ci);
-        Extract(general.at("initial_altitude"), ofp_info->altitude);
-        Extract(general.at("avg_tropopause"), ofp_info->tropopause);
-        Extract(general.at("avg_wind_comp"), ofp_info->wind_component);
-        Extract(general.at("avg_temp_dev"), ofp_info->isa_dev);
-        Extract(general.at("route"), ofp_info->route);
-        Extract(general.at("sid_ident"), ofp_info->sid);
+        Extract(general.at("icao_airline"), ofp_info, OfpField::icao_airline);
+        Extract(general.at("flight_number"), ofp_info, OfpField::flight_number);
+        Extract(general.at("costindex"), ofp_info, OfpField::ci);
+        Extract(general.at("initial_altitude"), ofp_info, OfpField::altitude);
+        Extract(general.at("avg_tropopause"), ofp_info, OfpField::tropopause);
+        Extract(general.at("avg_wind_comp"), ofp_info, OfpField::wind_component);
+        Extract(general.at("avg_temp_dev"), ofp_info, OfpField::isa_dev);
+        Extract(general.at("route"), ofp_info, OfpField::route);
+        Extract(general.at("sid_ident"), ofp_info, OfpField::sid);
 
         auto const& dx_rmk = general.at("dx_rmk");
         if (dx_rmk.is_string()) {
-            ofp_info->dx_rmk = dx_rmk.get<std::string>();
+            ofp_info.set_dx_rmk(dx_rmk.get<std::string>());
         } else if (dx_rmk.is_array()) {
-            // concatenate array entries with space
+            std::string str;
             for (const auto& item : dx_rmk) {
                 if (item.is_string()) {
-                    if (!ofp_info->dx_rmk.empty())
-                        ofp_info->dx_rmk += " ";
-                    ofp_info->dx_rmk += item.get<std::string>();
+                    if (!str.empty())
+                        str += " ";
+                    str += item.get<std::string>();
                 }
             }
+            ofp_info.set_dx_rmk(str);
         }
 
-        // there can be multiple or none alternate airports
         auto& alternate = data_obj.at("alternate");
         if (!alternate.empty()) {
             if (alternate.is_array())
                 alternate = alternate[0];  // take first
-            Extract(alternate.at("icao_code"), ofp_info->alternate);
-            Extract(alternate.at("route"), ofp_info->alt_route);
+            Extract(alternate.at("icao_code"), ofp_info, OfpField::alternate);
+            Extract(alternate.at("route"), ofp_info, OfpField::alt_route);
         }
 
         const auto& weights = data_obj.at("weights");
-        Extract(weights.at("oew"), ofp_info->oew);
-        Extract(weights.at("pax_count"), ofp_info->pax_count);
-        Extract(weights.at("freight_added"), ofp_info->freight);
-        Extract(weights.at("payload"), ofp_info->payload);
-        Extract(weights.at("max_zfw"), ofp_info->max_zfw);
-        Extract(weights.at("max_tow"), ofp_info->max_tow);
+        Extract(weights.at("oew"), ofp_info, OfpField::oew);
+        Extract(weights.at("pax_count"), ofp_info, OfpField::pax_count);
+        Extract(weights.at("freight_added"), ofp_info, OfpField::freight);
+        Extract(weights.at("payload"), ofp_info, OfpField::payload);
+        Extract(weights.at("max_zfw"), ofp_info, OfpField::max_zfw);
+        Extract(weights.at("max_tow"), ofp_info, OfpField::max_tow);
 
         const auto& times = data_obj.at("times");
-        Extract(times.at("est_time_enroute"), ofp_info->est_time_enroute);
-        Extract(times.at("est_out"), ofp_info->est_out);
-        Extract(times.at("est_off"), ofp_info->est_off);
-        Extract(times.at("est_on"), ofp_info->est_on);
-        Extract(times.at("est_in"), ofp_info->est_in);
+        Extract(times.at("est_time_enroute"), ofp_info, OfpField::est_time_enroute);
+        Extract(times.at("est_out"), ofp_info, OfpField::est_out);
+        Extract(times.at("est_off"), ofp_info, OfpField::est_off);
+        Extract(times.at("est_on"), ofp_info, OfpField::est_on);
+        Extract(times.at("est_in"), ofp_info, OfpField::est_in);
     } catch (const std::exception& e) {
-        LogMsg("error during JSON parsing: '%s'", e.what());
-        ofp_info->status = "Invalid JSON data";
-        ofp_info->stale = true;
-
-        // for debugging, log the received json without userid
-        data_obj["fetch"]["userid"] = "xxx";
-        data_obj["user_id"] = "xxx";
-        LogMsgRaw(data_obj.dump(4));
+        LogMsg("DOM parser: '%s'", e.what());
         return false;
     }
 
-    ofp_info->stale = false;
-    ofp_info->seqno = ++seqno;
-    LogMsg("OfpGetParse() success, seqno %d", ofp_info->seqno);
     return true;
 }
 
-#ifdef TEST_OFP_PARSE
-#include <ctime>
+// parse a recorded OFP with both parsers, compare results, time and heap usage
+static int Compare(const char* fn) {
+    std::ifstream f(fn);
+    if (!f.is_open()) {
+        LogMsg("Can't open '%s'", fn);
+        return 1;
+    }
+
+    std::stringstream ss;
+    ss << f.rdbuf();
+    const std::string json_str = ss.str();
+    LogMsg("'%s': %d bytes", fn, (int)json_str.length());
+
+    static constexpr int kRuns = 20;
+    auto Run = [&](const char* name, bool (*parser)(const std::string&, OfpInfo&), OfpInfo& ofp_info) {
+        double best = 1.0E10;
+        size_t allocs = 0, bytes = 0;
+        for (int i = 0; i < kRuns; i++) {
+            ofp_info = OfpInfo();
+            size_t n0 = n_alloc;
+            size_t b0 = n_bytes;
+            auto t0 = std::chrono::steady_clock::now();
+            parser(json_str, ofp_info);
+            auto t1 = std::chrono::steady_clock::now();
+            best = std::min(best, std::chrono::duration<double, std::micro>(t1 - t0).count());
+            allocs = n_alloc - n0;
+            bytes = n_bytes - b0;
+        }
+        LogMsg("%s: %8.1f us, %6d allocations, %8d bytes allocated", name, best, (int)allocs, (int)bytes);
+    };
+
+    OfpInfo sax_info, dom_info;
+    Run("SAX", OfpParse, sax_info);
+    Run("DOM", OfpParseDom, dom_info);
+
+    int diffs = 0;
+    for (const auto& fd : kOfpFields)
+        if (sax_info.fields.get((int)fd.field) != dom_info.fields.get((int)fd.field)) {
+            LogMsg("mismatch %s.%s: SAX '%s' DOM '%s'", kSectionNames[fd.section], fd.key,
+                   sax_info.fields.get((int)fd.field).data(), dom_info.fields.get((int)fd.field).data());
+            diffs++;
+        }
+
+    LogMsg("%d differences, navlog: %d fixes", diffs, sax_info.navlog.count());
+    return diffs ? 1 : 0;
+}
 
-const char* log_msg_prefix = "ofp_get_parse_test: ";
 //
 // call with
 // a.[out,exe] pilot_id
+// a.[out,exe] -c ofp.json    compare SAX and DOM parser on a recorded OFP
 //
 int main(int argc, char** argv) {
     if (argc < 2) {
@@ -213,22 +1091,22 @@ int main(int argc, char** argv) {
         exit(1);
     }
 
+    if (argc == 3 && strcmp(argv[1], "-c") == 0)
+        exit(Compare(argv[2]));
+
     const std::string pilot_id = argv[1];
     std::unique_ptr<OfpInfo> ofp_info;
-    if (!OfpGetParse(pilot_id, ofp_info)) {
+    if (OfpGetParse(pilot_id, 0, ofp_info) != kFetchNew) {
         LogMsg("OfpGetParse() failed");
         exit(1);
     }
 
     ofp_info->Dump();
-    time_t tg = atol(ofp_info->time_generated.c_str());
-    LogMsg("tg %ld", (long)tg);
-
-    auto tm = *std::gmtime(&tg);
-    char line[100];
-    snprintf(line, sizeof(line), "OFP generated at %4d-%02d-%02d %02d:%02d:%02d UTC", tm.tm_year + 1900, tm.tm_mon + 1,
-             tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
-    LogMsg("'%s'", line);
+    const OfpTimes& times = ofp_info->times;
+    LogMsg("tg %d", times.generated.epoch);
+    LogMsg("'OFP generated at %s UTC'", times.generated_utc);
+    LogMsg("out %s, off %s, on %s, in %s, block %d min, trip %s", times.out.hh_mm, times.off.hh_mm, times.on.hh_mm,
+           times.in.hh_mm, times.block_mins, times.trip_hhmm);
 
     exit(0);
 }
@@ -22,15 +22,19 @@
 // This code loosely follows
 // Google's style guide: https://google.github.io/styleguide/cppguide.html
 
+#include <climits>
 #include <cstdlib>
 #include <cstring>
 #include <cstdio>
 #include <ctime>
 #include <fstream>
+#include <sstream>
 #include <memory>
 #include <future>
 #include <chrono>
 #include <thread>
+#include <algorithm>
+#include <vector>
 
 #include "XPLMPlugin.h"
 #include "XPLMGraphics.h"
@@ -41,17 +45,20 @@
 
 #include "sbh.h"
 #include "ui.h"
+#include "http_fetch.h"
+#include "shm_export.h"
 
 #include "version.h"
 
 const char *log_msg_prefix = "sbh: ";
 
-static constexpr float kCdmPollInterval = 90.0f;  // s
 static constexpr float kCdmNoPoll = 100000.0f;    // never poll
+static constexpr float kFetchMaxDeferral = 10.0f;  // s, a stream of fetch requests can't postpone the fetch longer
 static constexpr float kAirtimeForArrival = 300.0f;  // s, airtime > this means arrival after a flight
+static constexpr int kOfpHistoryDefault = 4;
 
 static XPLMMenuID sbh_menu;
-static int fake_cdm_item;
+static int fake_cdm_item, prewarm_item;
 
 static XPLMDataRef acf_icao_dr, total_running_time_sec_dr, num_engines_dr, eng_running_dr, gear_fnrml_dr;
 static XPLMDataRef xpilot_status_dr, xpilot_callsign_dr;
@@ -59,24 +66,38 @@ static XPLMDataRef xpilot_status_dr, xpilot_callsign_dr;
 static XPLMFlightLoopID flight_loop_id;
 
 static int pref_fake_cdm;
+static int pref_prewarm = 1;    // open connections to simbrief and the cdm servers ahead of time
+int pref_ofp_poll_min;          // interval for polling simbrief for a new OFP, 0 = off
+int pref_ofp_history = kOfpHistoryDefault;  // number of previous OFPs kept
 
 bool error_disabled;
 
-static std::string xp_dir, base_dir, pref_path;
+static std::string xp_dir, base_dir, pref_path, snapshot_path;
 std::string pilot_id;
+std::string ofp_fetch_error;
 static std::string cdm_airport, callsign;
 static int cdm_seqno;
+static int cdm_poll_reason;     // CdmPollReason of cdm_next_poll_ts
+static int cdm_not_found;       // consecutive polls that did not find the flight
+static int ofp_fetch_result;   // OfpFetchResult of the last completed fetch
+static int ofp_fetch_seqno;    // incremented after each completed fetch, whatever the result
+static int first_ofp_ms = -1;  // duration of the first OFP download of the session, -1 = none yet
+static int first_cdm_ms = -1;  // same for the first CDM poll
 static bool fake_xpilot;    // faked by env var XPILOT_CALLSIGN=xxxx
 static bool xpilot_connected;
 
 
-static float now, air_time, cdm_next_poll_ts;
+static float now, air_time, cdm_next_poll_ts, ofp_next_poll_ts;
+static float ofp_fetch_due_ts;  // start of the pending fetch
+static float ofp_fetch_first_ts;  // first request that is coalesced into the pending fetch
+static int history_index;      // selects the entry for sbh/history/*, 0 = active OFP
 
 // A note on async processing:
 // Everything is synchronously fired by the flightloop so we don't need mutexes
 
 // these variables are owned and written by the main (= flightloop) thread
 bool ofp_download_active;
+bool ofp_fetch_pending;         // a fetch is requested, it starts at ofp_fetch_due_ts
 static bool cdm_download_active;
 std::unique_ptr<OfpInfo> ofp_info;
 std::unique_ptr<CdmInfo> cdm_info;
@@ -88,9 +109,151 @@ std::unique_ptr<CdmInfo> cdm_info;
 static std::unique_ptr<OfpInfo> ofp_info_new;
 static std::unique_ptr<CdmInfo> cdm_info_new;
 
+// Per field change tracking, updated when a new info is activated
+template <typename Info>
+struct FieldChanges {
+    static constexpr int kNumFields = (int)Info::Field::kNumFields;
+    int mask[(kNumFields + 31) / 32]{};  // bit i = field i differs from the previous info
+    int seqno[kNumFields]{};             // seqno of the info that changed field i last
+
+    // compare cur with prev (may be nullptr = all changed), record cur_seqno for changed fields and
+    // return true if any field differs.
+    // The mask is stored if a field differs or cur is activated anyway (activate = true), so it always belongs to
+    // the active seqno.
+    bool Update(const Info* prev, const Info& cur, int cur_seqno, bool activate) {
+        uint32_t m[(kNumFields + 31) / 32]{};  // std::size(mask) is not a constant expression here
+        bool changed = false;
+        for (int i = 0; i < kNumFields; i++)
+            if (prev == nullptr || prev->fields.get(i) != cur.fields.get(i)) {
+                m[i / 32] |= 1u << (i % 32);
+                seqno[i] = cur_seqno;
+                changed = true;
+            }
+
+        if (changed || activate)
+            for (size_t w = 0; w < std::size(mask); w++)
+                mask[w] = m[w];
+        return changed;
+    }
+};
+
+static FieldChanges<OfpInfo> ofp_changes;
+static FieldChanges<CdmInfo> cdm_changes;
+
+// Ring of previously active OFPs.
+// Entries are moved in when they are replaced, so pushing never allocates or copies.
+class OfpHistory {
+    std::vector<std::unique_ptr<OfpInfo>> ring_;
+    int head_{0};   // slot of the newest entry
+    int count_{0};
+
+   public:
+    // keep the newest n entries
+    void Resize(int n) {
+        n = std::max(n, 0);
+        std::vector<std::unique_ptr<OfpInfo>> ring(n);
+        int count = std::min(count_, n);
+        for (int i = 0; i < count; i++)  // newest to slot count - 1
+            ring[count - 1 - i] = std::move(ring_[(head_ - i + (int)ring_.size()) % (int)ring_.size()]);
+
+        ring_ = std::move(ring);
+        count_ = count;
+        head_ = std::max(count - 1, 0);
+    }
+
+    void Push(std::unique_ptr<OfpInfo> info) {
+        if (ring_.empty())
+            return;
+
+        info->raw = std::string();  // queries only run on the active OFP
+
+        head_ = (head_ + 1) % ring_.size();
+        ring_[head_] = std::move(info);
+        count_ = std::min(count_ + 1, (int)ring_.size());
+    }
+
+    // i = 0 is the newest entry
+    const OfpInfo* get(int i) const {
+        if (i < 0 || i >= count_)
+            return nullptr;
+        return ring_[(head_ - i + (int)ring_.size()) % (int)ring_.size()].get();
+    }
+
+    int count() const {
+        return count_;
+    }
+};
+
+static OfpHistory ofp_history;
+
+// json pointer query on the active OFP, evaluated lazily and memoized per OFP seqno
+struct OfpQuerySlot {
+    std::string pointer;
+    int seqno{-1};  // seqno of the OFP value was extracted from
+    std::string value;
+
+    std::string_view Eval() {
+        if (ofp_info == nullptr || ofp_info->seqno == 0)
+            return {};
+
+        // a snapshot OFP gets raw from the confirming fetch without a new seqno, don't memoize until then
+        if (ofp_info->raw.empty())
+            return {};
+
+        if (seqno != ofp_info->seqno) {
+            if (!OfpQuery(*ofp_info, pointer, value))
+                value.clear();
+            seqno = ofp_info->seqno;
+        }
+        return value;
+    }
+};
+
+static OfpQuerySlot query_slot;                 // sbh/query/path, sbh/query/value
+static std::vector<OfpQuerySlot> cfg_queries;   // sbh/query/<name> from query.cfg
+
+// query.cfg, a line per query:
+// <name> <json pointer>
+static void LoadQueryCfg(const std::string& path, std::vector<std::string>& names) {
+    std::ifstream f(path);
+    if (!f.is_open())
+        return;
+
+    std::string line;
+    while (std::getline(f, line)) {
+        std::istringstream is(line);
+        std::string name, pointer;
+        if (!(is >> name >> pointer) || name[0] == '#')
+            continue;
+
+        if (name == "path" || name == "value") {
+            LogMsg("query name '%s' is reserved", name.c_str());
+            continue;
+        }
+
+        LogMsg("query sbh/query/%s = '%s'", name.c_str(), pointer.c_str());
+        names.push_back(name);
+        cfg_queries.emplace_back().pointer = pointer;
+    }
+}
+
+void OfpHistoryResize() {
+    pref_ofp_history = std::clamp(pref_ofp_history, 0, 20);
+    ofp_history.Resize(pref_ofp_history);
+}
+
 // variable under system control
-static std::future<bool> ofp_download_future;
+static std::future<OfpFetchResult> ofp_download_future;
 static std::future<bool> cdm_download_future;
+static std::future<void> prewarm_future;
+
+// start and end of the download, the end is written by the download thread
+using Clock = std::chrono::steady_clock;
+static Clock::time_point ofp_download_start, ofp_download_end, cdm_download_start, cdm_download_end;
+
+static int Ms(Clock::time_point t0, Clock::time_point t1) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+}
 
 // forwards
 static void FetchCdm(void);
@@ -102,7 +265,8 @@ void SavePrefs() {
         return;
     }
 
-    f << std::format("{} {} {} {} {} {}\n", pilot_id, pref_fake_cdm, ui_left, ui_top, ui_right, ui_bottom);
+    f << std::format("{} {} {} {} {} {} {} {} {}\n", pilot_id, pref_fake_cdm, ui_left, ui_top, ui_right, ui_bottom,
+                     pref_ofp_poll_min, pref_ofp_history, pref_prewarm);
 }
 
 static void LoadPrefs() {
@@ -112,7 +276,26 @@ static void LoadPrefs() {
         return;
     }
 
-    f >> pilot_id >> pref_fake_cdm >> ui_left >> ui_top >> ui_right >> ui_bottom;
+    f >> pilot_id >> pref_fake_cdm >> ui_left >> ui_top >> ui_right >> ui_bottom >> pref_ofp_poll_min;  // 0 if missing
+    if (!(f >> pref_ofp_history))
+        pref_ofp_history = kOfpHistoryDefault;
+    if (!(f >> pref_prewarm))
+        pref_prewarm = 1;
+}
+
+static bool EnginesRunning() {
+    int er[8];
+    int n = 8;
+    if (num_engines_dr)
+        n = std::min(n, XPLMGetDatai(num_engines_dr));
+
+    n = XPLMGetDatavi(eng_running_dr, er, 0, n);
+
+    for (int i = 0; i < n; i++)
+        if (er[i])
+            return true;
+
+    return false;
 }
 
 // connected to xpilot, engine off, no airtime
@@ -139,17 +322,8 @@ bool CdmPollEnabled() {
             return false;
     }
 
-    // check engines
-    int er[8];
-    int n = 8;
-    if (num_engines_dr)
-        n = std::min(n, XPLMGetDatai(num_engines_dr));
-
-    n = XPLMGetDatavi(eng_running_dr, er, 0, n);
-
-    for (int i = 0; i < n; i++)
-        if (er[i])
-            return false;
+    if (EnginesRunning())
+        return false;
 
     if (air_time > kAirtimeForArrival)  // arrival after a flight
         return false;
@@ -157,30 +331,54 @@ bool CdmPollEnabled() {
     return true;
 }
 
+// polling for a re-dispatched OFP: configured, on ground, engines off
+static bool OfpPollEnabled() {
+    if (pref_ofp_poll_min <= 0 || pilot_id.empty() || ofp_download_active || ofp_fetch_pending)
+        return false;
+
+    if (XPLMGetDataf(gear_fnrml_dr) == 0.0f)  // airborne
+        return false;
+
+    return !EnginesRunning();
+}
+
 // fake cdm info from ofp info
 static void FakeCdm() {
     if (ofp_info == nullptr)
         return;
 
-    LogMsg("Faking CDM airport '%s'", ofp_info->origin.c_str());
-    time_t out_time = atol(ofp_info->est_out.c_str());
-    time_t off_time = atol(ofp_info->est_off.c_str());
-
-    auto out_tm = *gmtime(&out_time);
-    auto off_tm = *gmtime(&off_time);
-    char out[20], off[20];
-    strftime(out, sizeof(out), "%H%M", &out_tm);
-    strftime(off, sizeof(off), "%H%M", &off_tm);
-
-    cdm_info = std::make_unique<CdmInfo>();
-    cdm_info->status = kSuccess;
-    cdm_info->url = "faked from OFP";
-    cdm_info->tobt = out;
-    cdm_info->tsat = out;
-    cdm_info->ctot = off;
-    cdm_info->runway = ofp_info->origin_rwy;
-    cdm_info->sid = ofp_info->sid;
+    LogMsg("Faking CDM airport '%s'", ofp_info->origin().data());
+    const OfpTimes& times = ofp_info->times;
+
+    auto info = std::make_unique<CdmInfo>();
+    info->outcome = kCdmFound;
+    info->set_status(kSuccess);
+    info->set_url("faked from OFP");
+    info->set_tobt(times.out.hhmm);
+    info->set_tsat(times.out.hhmm);
+    info->set_ctot(times.off.hhmm);
+    info->times.tobt = times.out;
+    info->times.tsat = times.out;
+    info->times.ctot = times.off;
+    info->set_runway(ofp_info->origin_rwy());
+    info->set_sid(ofp_info->sid());
+    cdm_changes.Update(cdm_info.get(), *info, cdm_seqno + 1, true);
+    cdm_info = std::move(info);
     cdm_info->seqno = ++cdm_seqno;
+    ShmPublishCdm(cdm_info.get());
+}
+
+// start CDM processing for the active ofp
+static void ActivateOfp() {
+    cdm_airport = ofp_info->origin();
+
+    if (pref_fake_cdm)
+        FakeCdm();          // will be overwritten by real cdm data if available
+
+    cdm_next_poll_ts = now;  // schedule immediate CDM polling after OFP download
+    cdm_poll_reason = kCdmPollStart;
+    cdm_not_found = 0;
+    air_time = 0.0f;
 }
 
 //
@@ -192,22 +390,54 @@ bool OfpCheckAsyncDownload() {
             return true;
 
         ofp_download_active = false;
-        [[maybe_unused]] bool res = ofp_download_future.get();
-        ofp_info = std::move(ofp_info_new);
+        OfpFetchResult res = ofp_download_future.get();
+        ofp_fetch_result = res;
+        ofp_fetch_seqno++;
+        if (first_ofp_ms < 0) {
+            first_ofp_ms = Ms(ofp_download_start, ofp_download_end);
+            LogMsg("first OFP download took %d ms", first_ofp_ms);
+        }
 
-        LogMsg("OfpCheckAsyncDownload(): Download status: %s", ofp_info->status.c_str());
-        if (ofp_info->status != kSuccess) {
+        LogMsg("OfpCheckAsyncDownload(): Download status: %s, result: %d", ofp_info_new->status().data(), res);
+        if (res != kFetchFailed)
+            ofp_fetch_error.clear();
+
+        if (res == kFetchUnchanged && ofp_info) {
+            if (ofp_info->raw.empty())
+                ofp_info->raw = std::move(ofp_info_new->raw);  // not in the snapshot
+            ofp_info_new = nullptr;
+            // a stale ofp (snapshot or after a failed download) is confirmed by the server
+            if (ofp_info->stale) {
+                ofp_info->stale = false;
+                ShmPublishOfp(ofp_info.get());
+                ActivateOfp();
+            }
             return false;  // no download active
         }
 
-        ofp_info->altitude = std::to_string(atoi(ofp_info->altitude.c_str()) / 100); // -> FL
-        cdm_airport = ofp_info->origin;
-
-        if (pref_fake_cdm)
-            FakeCdm();          // will be overwritten by real cdm data if available
+        if (res != kFetchNew) {
+            // Keep previous data (e.g. the snapshot) of the same pilot but flag it as stale.
+            // The error of the server is shown in any case.
+            ofp_fetch_error = ofp_info_new->status();
+            if (ofp_info && ofp_info->seqno > 0 && ofp_info->pilot_id == ofp_info_new->pilot_id) {
+                ofp_info->stale = true;
+            } else {
+                if (ofp_info && ofp_info->seqno > 0)
+                    LogMsg("dropping the OFP of pilot id '%s'", ofp_info->pilot_id.c_str());
+                ofp_info = std::move(ofp_info_new);
+                cdm_airport.clear();
+            }
+            ofp_info_new = nullptr;
+            ShmPublishOfp(ofp_info.get());
+            return false;  // no download active
+        }
 
-        cdm_next_poll_ts = now;  // schedule immediate CDM polling after OFP download
-        air_time = 0.0f;
+        ofp_changes.Update(ofp_info.get(), *ofp_info_new, ofp_info_new->seqno, true);
+        if (ofp_info && ofp_info->seqno > 0)
+            ofp_history.Push(std::move(ofp_info));
+        ofp_info = std::move(ofp_info_new);
+        ShmPublishOfp(ofp_info.get());
+        ActivateOfp();
     }
 
     return false;
@@ -222,43 +452,75 @@ bool CdmCheckAsyncDownload() {
             return true;
 
         cdm_download_active = false;
-        cdm_next_poll_ts = now + kCdmPollInterval;
+        bool res = cdm_download_future.get();
+        if (first_cdm_ms < 0) {
+            first_cdm_ms = Ms(cdm_download_start, cdm_download_end);
+            LogMsg("first CDM poll took %d ms", first_cdm_ms);
+        }
 
-        [[maybe_unused]] bool res = cdm_download_future.get();
+        // an error in between keeps the not found backoff
+        if (res)
+            cdm_not_found = 0;
+        else if (cdm_info_new->outcome == kCdmNotFound)
+            cdm_not_found++;
+        int delay = CdmPollDelay(*cdm_info_new, cdm_not_found, cdm_poll_reason);
+        cdm_next_poll_ts = now + delay;
 
-        LogMsg("CdmCheckAsyncDownload(): Download status: %s", cdm_info_new->status.c_str());
+        LogMsg("CdmCheckAsyncDownload(): Download status: %s, next poll in %d s, reason: %d",
+               cdm_info_new->status().data(), delay, cdm_poll_reason);
         // do not overwrite a fake_cdm with a failed download
-        if (pref_fake_cdm && cdm_info_new->status != kSuccess) {
+        if (pref_fake_cdm && cdm_info_new->status() != kSuccess) {
             cdm_info_new = nullptr;  // discard failed real download
             return false;            // no download active
         }
 
-#define F_EQ(f) (cdm_info->f == cdm_info_new->f)
-        if (cdm_info && F_EQ(status) && F_EQ(tobt) && F_EQ(tsat) && F_EQ(runway) && F_EQ(sid)) {
+        if (!cdm_changes.Update(cdm_info.get(), *cdm_info_new, cdm_seqno + 1, false)) {
             cdm_info_new = nullptr;  // unchanged, discard
             return false;            // no download active
         }
-#undef F_EQ
 
         cdm_info = std::move(cdm_info_new);
         cdm_info->seqno = ++cdm_seqno;
+        ShmPublishCdm(cdm_info.get());
     }
 
     return false;
 }
 
-void FetchOfp(void) {
+// Request an OFP download.
+// All requests are coalesced into one pending fetch that is started by the flight loop 'delay' s after the last
+// request, but not before a running download has finished. So bursts result in a single download with the
+// pilot_id that is current at that time. The fetch is not deferred more than kFetchMaxDeferral after the first
+// request of a burst.
+void FetchOfp(float delay) {
+    float t = XPLMGetDataf(total_running_time_sec_dr);
+    if (!ofp_fetch_pending)
+        ofp_fetch_first_ts = t;
+
+    ofp_fetch_pending = true;
+    ofp_fetch_due_ts = std::min(t + delay, ofp_fetch_first_ts + kFetchMaxDeferral);
+    XPLMScheduleFlightLoop(flight_loop_id, std::max(ofp_fetch_due_ts - t, 0.1f), 1);
+}
+
+static void StartOfpDownload() {
     if (pilot_id.empty()) {
         LogMsg("pilot_id is not configured!");
         return;
     }
 
-    if (ofp_download_active) {
-        LogMsg("Download is already in progress, request ignored");
-        return;
-    }
-
-    ofp_download_future = std::async(std::launch::async, []() { return OfpGetParse(pilot_id, ofp_info_new); });
+    ofp_next_poll_ts = now + pref_ofp_poll_min * 60.0f;
+
+    // an unchanged plan is detected by its hash and not parsed again, so polling is cheap
+    // only a parsed OFP (maybe stale from the snapshot) can be confirmed that way
+    uint64_t active_hash = (ofp_info && ofp_info->status() == kSuccess) ? ofp_info->hash : 0;
+    ofp_download_start = Clock::now();
+    ofp_download_future = std::async(std::launch::async, [active_hash, id = pilot_id]() {
+        OfpFetchResult res = OfpGetParse(id, active_hash, ofp_info_new);
+        ofp_download_end = Clock::now();
+        if (res == kFetchNew)
+            OfpSaveSnapshot(snapshot_path, id, *ofp_info_new);
+        return res;
+    });
     ofp_download_active = true;
 }
 
@@ -276,11 +538,33 @@ static void FetchCdm() {
         return;
     }
 
-    cdm_download_future =
-        std::async(std::launch::async, []() { return CdmGetParse(cdm_airport, callsign, cdm_info_new); });
+    if (cdm_airport.empty())  // no OFP of the current pilot
+        return;
+
+    cdm_download_start = Clock::now();
+    cdm_download_future = std::async(std::launch::async, []() {
+        bool res = CdmGetParse(cdm_airport, callsign, cdm_info_new);
+        cdm_download_end = Clock::now();
+        return res;
+    });
     cdm_download_active = true;
 }
 
+// Open connections to simbrief, the cdm servers and their feed hosts in the background so the first
+// downloads don't pay DNS and TCP/TLS setup.
+// Called on plane load, the OFP fetch follows after the debounce and the first cdm poll soon after.
+static void Prewarm() {
+    if (!pref_prewarm || error_disabled)
+        return;
+
+    if (prewarm_future.valid() && std::future_status::ready != prewarm_future.wait_for(std::chrono::seconds::zero()))
+        return;  // still running
+
+    std::vector<std::string> urls = CdmGetServerUrls();
+    urls.insert(urls.begin(), kSimbriefUrl);
+    prewarm_future = std::async(std::launch::async, [urls = std::move(urls)]() { HttpPrewarm(urls); });
+}
+
 static void MenuCb([[maybe_unused]] void* menu_ref, [[maybe_unused]] void* item_ref) {
     if (error_disabled)
         return;
@@ -318,6 +602,11 @@ static float FlightLoopCb(float inElapsedSinceLastCall, [[maybe_unused]] float i
     OfpCheckAsyncDownload();
     CdmCheckAsyncDownload();
 
+    if (ofp_fetch_pending && !ofp_download_active && now >= ofp_fetch_due_ts) {
+        ofp_fetch_pending = false;
+        StartOfpDownload();
+    }
+
     if (XPLMGetDataf(gear_fnrml_dr) == 0.0f)
         air_time += inElapsedSinceLastCall;
 
@@ -331,12 +620,18 @@ static float FlightLoopCb(float inElapsedSinceLastCall, [[maybe_unused]] float i
         FetchCdm();
     }
 
-    return 5.0f;
+    if (now > ofp_next_poll_ts && OfpPollEnabled()) {
+        LogMsg("polling for a new OFP");
+        FetchOfp();
+    }
+
+    return ofp_fetch_pending ? 1.0f : 5.0f;
 }
 
 // Generic data accessor helper returning string data
-static int GenericDataAcc(const std::string* data, void* values, int ofs, int n) {
-    int len = data->length() + 1;  // we always offer a trailing 0
+// data must be followed by a NUL
+static int GenericDataAcc(std::string_view data, void* values, int ofs, int n) {
+    int len = data.length() + 1;  // we always offer a trailing 0
     if (values == nullptr)
         return len;
 
@@ -344,18 +639,91 @@ static int GenericDataAcc(const std::string* data, void* values, int ofs, int n)
         return 0;
 
     n = std::min(n, len - ofs);
-    memcpy(values, data->c_str() + ofs, n);
+    memcpy(values, data.data() + ofs, n);
     return n;
 }
 
 // data accessor
-// ref = offset of field (std::string) within OfpInfo
+// ref = OfpField index
 static int OfpDataAcc(void* ref, void* values, int ofs, int n) {
     if (ofp_info == nullptr || ofp_info->seqno == 0)  // not even stale data
         return 0;
 
-    const std::string* data = reinterpret_cast<const std::string*>((char*)ofp_info.get() + (size_t)ref);
-    return GenericDataAcc(data, values, ofs, n);
+    return GenericDataAcc(ofp_info->fields.get((int)(intptr_t)ref), values, ofs, n);
+}
+
+// Generic array accessor helper
+template <typename T>
+static int GenericArrayAcc(const T* data, int len, T* values, int ofs, int n) {
+    if (values == nullptr)
+        return len;
+
+    if (n <= 0 || ofs < 0 || ofs >= len)
+        return 0;
+
+    n = std::min(n, len - ofs);
+    memcpy(values, data + ofs, n * sizeof(T));
+    return n;
+}
+
+template <typename T>
+static int GenericArrayAcc(const std::vector<T>& data, T* values, int ofs, int n) {
+    return GenericArrayAcc(data.data(), (int)data.size(), values, ofs, n);
+}
+
+// float array accessor
+// ref = offset of field (std::vector<float>) within Navlog
+static int NavlogFloatAcc(void* ref, float* values, int ofs, int n) {
+    if (ofp_info == nullptr || ofp_info->seqno == 0)
+        return 0;
+
+    const auto* data = reinterpret_cast<const std::vector<float>*>((char*)&ofp_info->navlog + (size_t)ref);
+    return GenericArrayAcc(*data, values, ofs, n);
+}
+
+static int NavlogIdentOfsAcc([[maybe_unused]] void* ref, int* values, int ofs, int n) {
+    if (ofp_info == nullptr || ofp_info->seqno == 0)
+        return 0;
+
+    return GenericArrayAcc(ofp_info->navlog.ident_ofs, values, ofs, n);
+}
+
+static int NavlogIdentsAcc([[maybe_unused]] void* ref, void* values, int ofs, int n) {
+    if (ofp_info == nullptr || ofp_info->seqno == 0)
+        return 0;
+
+    return GenericDataAcc(ofp_info->navlog.idents, values, ofs, n);
+}
+
+// route token accessors
+// ref = offset of the RouteTokens within OfpInfo
+static const RouteTokens* RouteTokensRef(void* ref) {
+    if (ofp_info == nullptr || ofp_info->seqno == 0)
+        return nullptr;
+
+    return reinterpret_cast<const RouteTokens*>((char*)ofp_info.get() + (size_t)ref);
+}
+
+static int RouteCountAcc(void* ref) {
+    const RouteTokens* tokens = RouteTokensRef(ref);
+    return tokens ? tokens->count() : 0;
+}
+
+static int RouteOfsAcc(void* ref, int* values, int ofs, int n) {
+    const RouteTokens* tokens = RouteTokensRef(ref);
+    return tokens ? GenericArrayAcc(tokens->ofs, values, ofs, n) : 0;
+}
+
+static int RouteTypeAcc(void* ref, int* values, int ofs, int n) {
+    const RouteTokens* tokens = RouteTokensRef(ref);
+    return tokens ? GenericArrayAcc(tokens->type, values, ofs, n) : 0;
+}
+
+static int NavlogCountAcc([[maybe_unused]] void* ref) {
+    if (ofp_info == nullptr || ofp_info->seqno == 0)
+        return 0;
+
+    return ofp_info->navlog.count();
 }
 
 // int accessor
@@ -368,18 +736,182 @@ static int OfpIntAcc(void* ref) {
     return *data;
 }
 
+// int accessor
+// ref = offset of field (int) within OfpNum
+static int OfpNumIntAcc(void* ref) {
+    if (ofp_info == nullptr || ofp_info->seqno == 0)
+        return 0;
+
+    return *reinterpret_cast<const int*>((const char*)&ofp_info->num + (size_t)ref);
+}
+
+// float accessor
+// ref = offset of field (float) within OfpNum
+static float OfpNumFloatAcc(void* ref) {
+    if (ofp_info == nullptr || ofp_info->seqno == 0)
+        return 0.0f;
+
+    return *reinterpret_cast<const float*>((const char*)&ofp_info->num + (size_t)ref);
+}
+
+// int accessor
+// ref = offset of field (int) within OfpTimes
+static int OfpTimeIntAcc(void* ref) {
+    if (ofp_info == nullptr || ofp_info->seqno == 0)
+        return 0;
+
+    return *reinterpret_cast<const int*>((const char*)&ofp_info->times + (size_t)ref);
+}
+
+// data accessor
+// ref = offset of field (NUL terminated char array) within OfpTimes
+static int OfpTimeDataAcc(void* ref, void* values, int ofs, int n) {
+    if (ofp_info == nullptr || ofp_info->seqno == 0)
+        return 0;
+
+    return GenericDataAcc((const char*)&ofp_info->times + (size_t)ref, values, ofs, n);
+}
+
+// int array accessors for the change tracking
+static int OfpChangedMaskAcc([[maybe_unused]] void* ref, int* values, int ofs, int n) {
+    return GenericArrayAcc(ofp_changes.mask, std::size(ofp_changes.mask), values, ofs, n);
+}
+
+static int OfpFieldSeqnoAcc([[maybe_unused]] void* ref, int* values, int ofs, int n) {
+    return GenericArrayAcc(ofp_changes.seqno, std::size(ofp_changes.seqno), values, ofs, n);
+}
+
+static int CdmChangedMaskAcc([[maybe_unused]] void* ref) {
+    return cdm_changes.mask[0];
+}
+
+static int CdmFieldSeqnoAcc([[maybe_unused]] void* ref, int* values, int ofs, int n) {
+    return GenericArrayAcc(cdm_changes.seqno, std::size(cdm_changes.seqno), values, ofs, n);
+}
+
+// s until the next cdm poll, 0 = due (e.g. waiting for engine off), -1 = download in progress
+static float CdmNextPollAcc([[maybe_unused]] void* ref) {
+    if (cdm_download_active || cdm_next_poll_ts == kCdmNoPoll)
+        return -1.0f;
+    return std::max(0.0f, cdm_next_poll_ts - XPLMGetDataf(total_running_time_sec_dr));
+}
+
+static int CdmPollReasonAcc([[maybe_unused]] void* ref) {
+    return cdm_poll_reason;
+}
+
+// entry selected by history_index
+static const OfpInfo* HistoryEntry() {
+    if (history_index == 0)
+        return ofp_info.get();
+    return ofp_history.get(history_index - 1);
+}
+
+// data accessor
+// ref = OfpField index
+static int HistoryDataAcc(void* ref, void* values, int ofs, int n) {
+    const OfpInfo* entry = HistoryEntry();
+    if (entry == nullptr || entry->seqno == 0)
+        return 0;
+
+    return GenericDataAcc(entry->fields.get((int)(intptr_t)ref), values, ofs, n);
+}
+
+static int HistorySeqnoAcc([[maybe_unused]] void* ref) {
+    const OfpInfo* entry = HistoryEntry();
+    return entry ? entry->seqno : 0;
+}
+
+static int HistoryCountAcc([[maybe_unused]] void* ref) {
+    return (ofp_info && ofp_info->seqno > 0) + ofp_history.count();
+}
+
+static void HistoryIndexWrite([[maybe_unused]] void* ref, int val) {
+    history_index = std::max(val, 0);
+}
+
+// data accessors for queries
+static int QueryValueAcc([[maybe_unused]] void* ref, void* values, int ofs, int n) {
+    return GenericDataAcc(query_slot.Eval(), values, ofs, n);
+}
+
+static int QueryPathAcc([[maybe_unused]] void* ref, void* values, int ofs, int n) {
+    return GenericDataAcc(query_slot.pointer, values, ofs, n);
+}
+
+// write of a new pointer, a trailing 0 is optional
+static void QueryPathWrite([[maybe_unused]] void* ref, void* values, int ofs, int n) {
+    if (ofs < 0 || n < 0)
+        return;
+
+    std::string& pointer = query_slot.pointer;
+    pointer.resize(std::min((size_t)ofs, pointer.size()));
+    pointer.append(static_cast<const char*>(values), n);
+    pointer.resize(strnlen(pointer.c_str(), pointer.size()));
+    query_slot.seqno = -1;
+}
+
+static int FetchErrorAcc([[maybe_unused]] void* ref, void* values, int ofs, int n) {
+    return GenericDataAcc(ofp_fetch_error, values, ofs, n);
+}
+
+// ref = index into cfg_queries
+static int CfgQueryAcc(void* ref, void* values, int ofs, int n) {
+    return GenericDataAcc(cfg_queries[(size_t)ref].Eval(), values, ofs, n);
+}
+
+// int accessor
+// ref = address of a static int
+static int StaticIntAcc(void* ref) {
+    return *reinterpret_cast<int*>(ref);
+}
+
+// int accessor
+// ref = offset of field (uint64_t) within HttpStats
+static int HttpStatsAcc(void* ref) {
+    HttpStats stats = HttpGetStats();
+    uint64_t val = *reinterpret_cast<uint64_t*>((char*)&stats + (size_t)ref);
+    return (int)std::min<uint64_t>(val, INT_MAX);  // saturate, e.g. bytes after 2 GB
+}
+
+// int array accessor, index = cdm server
+// ref = offset of field (int) within CdmServerStats
+static int CdmServerStatsAcc(void* ref, int* values, int ofs, int n) {
+    std::vector<int> data;
+    for (const auto& stats : CdmGetServerStats())
+        data.push_back(*reinterpret_cast<const int*>((const char*)&stats + (size_t)ref));
+    return GenericArrayAcc(data, values, ofs, n);
+}
+
 // data accessor
-// ref = offset of field (std::string) within CdmInfo
+// ref = CdmField index
 static int CdmDataAcc(void* ref, void* values, int ofs, int n) {
     if (cdm_info == nullptr || cdm_info->seqno == 0)  // not even stale data
         return 0;
 
-    const std::string* data = reinterpret_cast<const std::string*>((char*)cdm_info.get() + (size_t)ref);
-    return GenericDataAcc(data, values, ofs, n);
+    return GenericDataAcc(cdm_info->fields.get((int)(intptr_t)ref), values, ofs, n);
 }
 
 // int accessor
-// ref = offset of field (int) within OfpInfo
+// ref = offset of field (int) within CdmTimes
+static int CdmTimeIntAcc(void* ref) {
+    if (cdm_info == nullptr || cdm_info->seqno == 0)
+        return 0;
+
+    return *reinterpret_cast<const int*>((const char*)&cdm_info->times + (size_t)ref);
+}
+
+// data accessor
+// ref = offset of field (NUL terminated char array) within CdmTimes
+static int CdmTimeDataAcc(void* ref, void* values, int ofs, int n) {
+    if (cdm_info == nullptr || cdm_info->seqno == 0)
+        return 0;
+
+    return GenericDataAcc((const char*)&cdm_info->times + (size_t)ref, values, ofs, n);
+}
+
+// int accessor
+// ref = offset of field (int) within CdmInfo
 static int CdmIntAcc(void* ref) {
     if (cdm_info == nullptr)
         return 0;
@@ -391,10 +923,36 @@ static int CdmIntAcc(void* ref) {
 /// ------------------------------------------------------ API --------------------------------------------
 #define OFP_DATA_DREF(f)                                                                                              \
     XPLMRegisterDataAccessor("sbh/" #f, xplmType_Data, 0, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, \
-                             OfpDataAcc, NULL, (void*)offsetof(OfpInfo, f), NULL)
+                             OfpDataAcc, NULL, (void*)(intptr_t)OfpField::f, NULL)
+#define NUM_INT_DREF(f)                                                                                        \
+    XPLMRegisterDataAccessor("sbh/num/" #f, xplmType_Int, 0, OfpNumIntAcc, NULL, NULL, NULL, NULL, NULL, NULL, \
+                             NULL, NULL, NULL, NULL, NULL, (void*)offsetof(OfpNum, f), NULL);
+#define NUM_FLOAT_DREF(f)                                                                                          \
+    XPLMRegisterDataAccessor("sbh/num/" #f, xplmType_Float, 0, NULL, NULL, OfpNumFloatAcc, NULL, NULL, NULL, NULL, \
+                             NULL, NULL, NULL, NULL, NULL, (void*)offsetof(OfpNum, f), NULL);
+#define HISTORY_DATA_DREF(f)                                                                                  \
+    XPLMRegisterDataAccessor("sbh/history/" #f, xplmType_Data, 0, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, \
+                             NULL, NULL, HistoryDataAcc, NULL, (void*)(intptr_t)OfpField::f, NULL);
+#define NAVLOG_FLOAT_DREF(f)                                                                                    \
+    XPLMRegisterDataAccessor("sbh/navlog/" #f, xplmType_FloatArray, 0, NULL, NULL, NULL, NULL, NULL, NULL, NULL, \
+                             NULL, NavlogFloatAcc, NULL, NULL, NULL, (void*)offsetof(Navlog, f), NULL)
+#define TIME_INT_DREF(name, acc, ofs)                                                                       \
+    XPLMRegisterDataAccessor(name, xplmType_Int, 0, acc, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, \
+                             NULL, (void*)(ofs), NULL)
+#define TIME_DATA_DREF(name, acc, ofs)                                                                             \
+    XPLMRegisterDataAccessor(name, xplmType_Data, 0, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, acc, \
+                             NULL, (void*)(ofs), NULL)
+// the 4 datarefs of a TimeView
+#define TIME_VIEW_DREFS(prefix, f, Times, int_acc, data_acc)                                                  \
+    TIME_INT_DREF(prefix #f "_epoch", int_acc, offsetof(Times, f) + offsetof(TimeView, epoch));              \
+    TIME_INT_DREF(prefix #f "_mins", int_acc, offsetof(Times, f) + offsetof(TimeView, mins));                \
+    TIME_DATA_DREF(prefix #f "_hhmm", data_acc, offsetof(Times, f) + offsetof(TimeView, hhmm));              \
+    TIME_DATA_DREF(prefix #f "_hh_mm", data_acc, offsetof(Times, f) + offsetof(TimeView, hh_mm));
+#define OFP_TIME_DREFS(f) TIME_VIEW_DREFS("sbh/time/", f, OfpTimes, OfpTimeIntAcc, OfpTimeDataAcc)
+#define CDM_TIME_DREFS(f) TIME_VIEW_DREFS("sbh/cdm/time/", f, CdmTimes, CdmTimeIntAcc, CdmTimeDataAcc)
 #define CDM_DATA_DREF(f)                                                                                            \
     XPLMRegisterDataAccessor("sbh/cdm/" #f, xplmType_Data, 0, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, \
-                             NULL, CdmDataAcc, NULL, (void*)offsetof(CdmInfo, f), NULL)
+                             NULL, CdmDataAcc, NULL, (void*)(intptr_t)CdmField::f, NULL)
 
 PLUGIN_API int XPluginStart(char* out_name, char* out_sig, char* out_desc) {
     LogMsg("startup " VERSION);
@@ -413,14 +971,28 @@ PLUGIN_API int XPluginStart(char* out_name, char* out_sig, char* out_desc) {
     xp_dir = std::string(buffer);
     base_dir = xp_dir + "Resources/plugins/simbrief_hub/";
     pref_path = xp_dir + "Output/preferences/simbrief_hub.prf";
+    snapshot_path = xp_dir + "Output/preferences/simbrief_hub_ofp.snap";
 
     if (!(CdmInit(base_dir + "cdm_cfg.json") || CdmInit(base_dir + "cdm_cfg.default.json"))) {
         LogMsg("Can't find cdm_cfg.json");
         return 0;
     }
 
+    CdmLoadAirportCache(xp_dir + "Output/preferences/simbrief_hub_cdm_airports.cache");
+
     LoadPrefs();
 
+    std::vector<std::string> query_names;
+    LoadQueryCfg(base_dir + "query.cfg", query_names);
+
+    // make the last OFP available right away, it's replaced by the fetch after plane load
+    OfpHistoryResize();
+    ShmInit(xp_dir + "Output/simbrief_hub.shm");
+    if (!pilot_id.empty() && OfpLoadSnapshot(snapshot_path, pilot_id, ofp_info)) {
+        ofp_changes.Update(nullptr, *ofp_info, ofp_info->seqno, true);
+        ShmPublishOfp(ofp_info.get());
+    }
+
     ImgWindowIni();
 
     // map standard datarefs
@@ -458,9 +1030,25 @@ PLUGIN_API int XPluginStart(char* out_name, char* out_sig, char* out_desc) {
             XPLMCheckMenuItem(sbh_menu, fake_cdm_item, pref_fake_cdm ? xplm_Menu_Checked : xplm_Menu_Unchecked);
             if (pref_fake_cdm)
                 FakeCdm();
-            else
+            else {
                 cdm_info = nullptr;
+                ShmPublishCdm(nullptr);
+            }
+
+            return 0;
+        },
+        0, NULL);
+
+    XPLMCommandRef prewarm_cmdr = XPLMCreateCommand("sbh/toggle_prewarm", "Toggle prewarming of connections");
+    XPLMRegisterCommandHandler(
+        prewarm_cmdr,
+        [](XPLMCommandRef, XPLMCommandPhase phase, void*) -> int {
+            if (xplm_CommandBegin != phase)
+                return 0;
 
+            pref_prewarm = !pref_prewarm;
+            LogMsg("pref_prewarm set to %d", pref_prewarm);
+            XPLMCheckMenuItem(sbh_menu, prewarm_item, pref_prewarm ? xplm_Menu_Checked : xplm_Menu_Unchecked);
             return 0;
         },
         0, NULL);
@@ -471,6 +1059,8 @@ PLUGIN_API int XPluginStart(char* out_name, char* out_sig, char* out_desc) {
     sbh_menu = XPLMCreateMenu("Simbrief Hub", menu, sub_menu, MenuCb, NULL);
     XPLMAppendMenuItem(sbh_menu, "Show widget", NULL, 0);
     fake_cdm_item = XPLMAppendMenuItemWithCommand(sbh_menu, "Fake CDM", fake_cmdr);
+    prewarm_item = XPLMAppendMenuItemWithCommand(sbh_menu, "Prewarm connections", prewarm_cmdr);
+    XPLMCheckMenuItem(sbh_menu, prewarm_item, pref_prewarm ? xplm_Menu_Checked : xplm_Menu_Unchecked);
 
     XPLMCreateFlightLoop_t create_flight_loop = {sizeof(XPLMCreateFlightLoop_t),
                                                  xplm_FlightLoop_Phase_BeforeFlightModel, FlightLoopCb, NULL};
@@ -512,12 +1102,90 @@ PLUGIN_API int XPluginStart(char* out_name, char* out_sig, char* out_desc) {
     OFP_DATA_DREF(max_tow);
     OFP_DATA_DREF(dx_rmk);
 
+    OFP_INT_FIELDS(NUM_INT_DREF)
+    OFP_FLOAT_FIELDS(NUM_FLOAT_DREF)
+
+    OFP_TIMES(OFP_TIME_DREFS)
+    TIME_INT_DREF("sbh/time/block_mins", OfpTimeIntAcc, offsetof(OfpTimes, block_mins));
+    TIME_INT_DREF("sbh/time/trip_mins", OfpTimeIntAcc, offsetof(OfpTimes, trip_mins));
+    TIME_DATA_DREF("sbh/time/trip_hhmm", OfpTimeDataAcc, offsetof(OfpTimes, trip_hhmm));
+    TIME_DATA_DREF("sbh/time/generated_utc", OfpTimeDataAcc, offsetof(OfpTimes, generated_utc));
+
     XPLMRegisterDataAccessor("sbh/stale", xplmType_Int, 0, OfpIntAcc, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
                              NULL, NULL, NULL, (void*)offsetof(OfpInfo, stale), NULL);
 
     XPLMRegisterDataAccessor("sbh/seqno", xplmType_Int, 0, OfpIntAcc, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
                              NULL, NULL, NULL, (void*)offsetof(OfpInfo, seqno), NULL);
 
+    XPLMRegisterDataAccessor("sbh/changed_mask", xplmType_IntArray, 0, NULL, NULL, NULL, NULL, NULL, NULL,
+                             OfpChangedMaskAcc, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+
+    XPLMRegisterDataAccessor("sbh/field_seqno", xplmType_IntArray, 0, NULL, NULL, NULL, NULL, NULL, NULL,
+                             OfpFieldSeqnoAcc, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+
+    XPLMRegisterDataAccessor("sbh/query/path", xplmType_Data, 1, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+                             NULL, NULL, QueryPathAcc, QueryPathWrite, NULL, NULL);
+
+    XPLMRegisterDataAccessor("sbh/query/value", xplmType_Data, 0, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+                             NULL, NULL, QueryValueAcc, NULL, NULL, NULL);
+
+    for (size_t i = 0; i < query_names.size(); i++)
+        XPLMRegisterDataAccessor(("sbh/query/" + query_names[i]).c_str(), xplmType_Data, 0, NULL, NULL, NULL, NULL,
+                                 NULL, NULL, NULL, NULL, NULL, NULL, CfgQueryAcc, NULL, (void*)i, NULL);
+
+    XPLMRegisterDataAccessor("sbh/fetch_result", xplmType_Int, 0, StaticIntAcc, NULL, NULL, NULL, NULL, NULL, NULL,
+                             NULL, NULL, NULL, NULL, NULL, &ofp_fetch_result, NULL);
+
+    XPLMRegisterDataAccessor("sbh/fetch_seqno", xplmType_Int, 0, StaticIntAcc, NULL, NULL, NULL, NULL, NULL, NULL,
+                             NULL, NULL, NULL, NULL, NULL, &ofp_fetch_seqno, NULL);
+
+    XPLMRegisterDataAccessor("sbh/fetch_error", xplmType_Data, 0, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+                             NULL, NULL, FetchErrorAcc, NULL, NULL, NULL);
+
+    XPLMRegisterDataAccessor("sbh/stats/first_ofp_ms", xplmType_Int, 0, StaticIntAcc, NULL, NULL, NULL, NULL, NULL,
+                             NULL, NULL, NULL, NULL, NULL, NULL, &first_ofp_ms, NULL);
+
+    XPLMRegisterDataAccessor("sbh/stats/first_cdm_ms", xplmType_Int, 0, StaticIntAcc, NULL, NULL, NULL, NULL, NULL,
+                             NULL, NULL, NULL, NULL, NULL, NULL, &first_cdm_ms, NULL);
+
+    XPLMRegisterDataAccessor("sbh/history/count", xplmType_Int, 0, HistoryCountAcc, NULL, NULL, NULL, NULL, NULL,
+                             NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+
+    XPLMRegisterDataAccessor("sbh/history/index", xplmType_Int, 1, StaticIntAcc, HistoryIndexWrite, NULL, NULL, NULL,
+                             NULL, NULL, NULL, NULL, NULL, NULL, NULL, &history_index, NULL);
+
+    XPLMRegisterDataAccessor("sbh/history/seqno", xplmType_Int, 0, HistorySeqnoAcc, NULL, NULL, NULL, NULL, NULL,
+                             NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+
+    OFP_FIELDS(HISTORY_DATA_DREF)
+
+    NAVLOG_FLOAT_DREF(lat);
+    NAVLOG_FLOAT_DREF(lon);
+    NAVLOG_FLOAT_DREF(altitude);
+    NAVLOG_FLOAT_DREF(distance);
+    NAVLOG_FLOAT_DREF(ete);
+    NAVLOG_FLOAT_DREF(fuel);
+
+    XPLMRegisterDataAccessor("sbh/navlog/count", xplmType_Int, 0, NavlogCountAcc, NULL, NULL, NULL, NULL, NULL, NULL,
+                             NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+
+    XPLMRegisterDataAccessor("sbh/navlog/ident_ofs", xplmType_IntArray, 0, NULL, NULL, NULL, NULL, NULL, NULL,
+                             NavlogIdentOfsAcc, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+
+    XPLMRegisterDataAccessor("sbh/navlog/idents", xplmType_Data, 0, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+                             NULL, NULL, NavlogIdentsAcc, NULL, NULL, NULL);
+
+#define ROUTE_DREFS(f)                                                                                            \
+    XPLMRegisterDataAccessor("sbh/" #f "/count", xplmType_Int, 0, RouteCountAcc, NULL, NULL, NULL, NULL, NULL, NULL, \
+                             NULL, NULL, NULL, NULL, NULL, (void*)offsetof(OfpInfo, f##_tokens), NULL);            \
+    XPLMRegisterDataAccessor("sbh/" #f "/ofs", xplmType_IntArray, 0, NULL, NULL, NULL, NULL, NULL, NULL,           \
+                             RouteOfsAcc, NULL, NULL, NULL, NULL, NULL, (void*)offsetof(OfpInfo, f##_tokens), NULL); \
+    XPLMRegisterDataAccessor("sbh/" #f "/type", xplmType_IntArray, 0, NULL, NULL, NULL, NULL, NULL, NULL,          \
+                             RouteTypeAcc, NULL, NULL, NULL, NULL, NULL, (void*)offsetof(OfpInfo, f##_tokens), NULL)
+    ROUTE_DREFS(route);
+    ROUTE_DREFS(alt_route);
+#undef ROUTE_DREFS
+
     CDM_DATA_DREF(url);
     CDM_DATA_DREF(status);
     CDM_DATA_DREF(tobt);
@@ -525,10 +1193,44 @@ PLUGIN_API int XPluginStart(char* out_name, char* out_sig, char* out_desc) {
     CDM_DATA_DREF(ctot);
     CDM_DATA_DREF(runway);
     CDM_DATA_DREF(sid);
+    CDM_TIMES(CDM_TIME_DREFS)
 
     XPLMRegisterDataAccessor("sbh/cdm/seqno", xplmType_Int, 0, CdmIntAcc, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
                              NULL, NULL, NULL, NULL, (void*)offsetof(CdmInfo, seqno), NULL);
 
+    XPLMRegisterDataAccessor("sbh/cdm/next_poll", xplmType_Float, 0, NULL, NULL, CdmNextPollAcc, NULL, NULL, NULL,
+                             NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+
+    XPLMRegisterDataAccessor("sbh/cdm/poll_reason", xplmType_Int, 0, CdmPollReasonAcc, NULL, NULL, NULL, NULL, NULL,
+                             NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+
+    XPLMRegisterDataAccessor("sbh/cdm/changed_mask", xplmType_Int, 0, CdmChangedMaskAcc, NULL, NULL, NULL, NULL, NULL,
+                             NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+
+    XPLMRegisterDataAccessor("sbh/cdm/field_seqno", xplmType_IntArray, 0, NULL, NULL, NULL, NULL, NULL, NULL,
+                             CdmFieldSeqnoAcc, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+
+#define HTTP_STATS_DREF(f)                                                                                     \
+    XPLMRegisterDataAccessor("sbh/stats/http_" #f, xplmType_Int, 0, HttpStatsAcc, NULL, NULL, NULL, NULL, NULL, \
+                             NULL, NULL, NULL, NULL, NULL, NULL, (void*)offsetof(HttpStats, f), NULL)
+    HTTP_STATS_DREF(requests);
+    HTTP_STATS_DREF(failures);
+    HTTP_STATS_DREF(not_modified);
+    HTTP_STATS_DREF(wire_bytes);
+    HTTP_STATS_DREF(decoded_bytes);
+    HTTP_STATS_DREF(buffer_reuses);
+    HTTP_STATS_DREF(buffer_peak);
+    HTTP_STATS_DREF(connects_new);
+    HTTP_STATS_DREF(connects_reused);
+#undef HTTP_STATS_DREF
+
+    XPLMRegisterDataAccessor("sbh/stats/cdm_server_state", xplmType_IntArray, 0, NULL, NULL, NULL, NULL, NULL, NULL,
+                             CdmServerStatsAcc, NULL, NULL, NULL, NULL, NULL,
+                             (void*)offsetof(CdmServerStats, state), NULL);
+    XPLMRegisterDataAccessor("sbh/stats/cdm_server_next_probe", xplmType_IntArray, 0, NULL, NULL, NULL, NULL, NULL,
+                             NULL, CdmServerStatsAcc, NULL, NULL, NULL, NULL, NULL,
+                             (void*)offsetof(CdmServerStats, next_probe), NULL);
+
     const char* cs = getenv("XPILOT_CALLSIGN");
     if (cs) {
         fake_xpilot = true;
@@ -540,6 +1242,10 @@ PLUGIN_API int XPluginStart(char* out_name, char* out_sig, char* out_desc) {
     return 1;
 }
 #undef OFP_DATA_DREF
+#undef NUM_INT_DREF
+#undef NUM_FLOAT_DREF
+#undef HISTORY_DATA_DREF
+#undef NAVLOG_FLOAT_DREF
 
 PLUGIN_API void XPluginStop(void) {
     // As an async can not be cancelled we have to wait
@@ -549,8 +1255,14 @@ PLUGIN_API void XPluginStop(void) {
         std::this_thread::sleep_for(std::chrono::seconds(2));
     }
 
+    if (prewarm_future.valid())
+        prewarm_future.wait();
+
+    CdmFini();
+    HttpFini();
     ui = nullptr;
     ImgWindowFini();
+    ShmFini();
 }
 
 PLUGIN_API void XPluginDisable(void) {
@@ -576,6 +1288,7 @@ PLUGIN_API void XPluginReceiveMessage([[maybe_unused]] XPLMPluginID in_from, lon
             LogMsg("%s", xpilot_status_dr ? "xPilot is installed" : "xPilot is not installed, CDM disabled");
         }
 
+        Prewarm();
         FetchOfp();
     }
 }
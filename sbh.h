@@ -19,78 +19,427 @@
 //    USA
 //
 
+#include <cstdint>
+#include <ctime>
+#include <array>
 #include <string>
+#include <string_view>
 #include <memory>
+#include <unordered_map>
+#include <vector>
 
 #include "log_msg.h"
 
 static constexpr const char* kSuccess ="Success";
+static constexpr const char* kSimbriefUrl = "https://www.simbrief.com";
+
+// result of an OFP fetch, exported as sbh/fetch_result
+enum OfpFetchResult {
+    kFetchNone = 0,       // no fetch completed yet
+    kFetchNew = 1,        // new OFP activated
+    kFetchUnchanged = 2,  // server returned the active OFP
+    kFetchFailed = 3,
+};
+
+// FNV-1a, fast non-cryptographic hash
+static inline uint64_t Fnv1a(std::string_view s, uint64_t h = 0xcbf29ce484222325ULL) {
+    for (unsigned char c : s) {
+        h ^= c;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+// Storage for the string fields of OfpInfo and CdmInfo.
+// All values live back to back in one block, each NUL terminated. Slot i holds offset and length of field i.
+// So filling an info costs a single allocation and accessors hand out string_views with a trailing NUL.
+// Setting a field appends the new value, the bytes of an overwritten value are released with the block.
+template <int N, size_t kReserve>
+class FieldArena {
+    struct Slot {
+        uint32_t ofs;
+        uint32_t len;
+    };
+    static_assert(sizeof(Slot) == 2 * sizeof(uint32_t));
+
+    std::array<Slot, N> slots_{};  // {0, 0} = the empty string at block_[0]
+    std::string block_;
+
+   public:
+    FieldArena() {
+        block_.reserve(kReserve);
+        block_.push_back('\0');
+    }
+
+    std::string_view get(int i) const {
+        return std::string_view(block_.data() + slots_[i].ofs, slots_[i].len);
+    }
+
+    void Set(int i, std::string_view val) {
+        slots_[i] = {(uint32_t)block_.size(), (uint32_t)val.size()};
+        block_.append(val);
+        block_.push_back('\0');
+    }
+
+    // append to field i, in place if it was written last
+    void Append(int i, std::string_view val) {
+        if (slots_[i].len == 0) {
+            Set(i, val);
+            return;
+        }
+
+        if (slots_[i].ofs + slots_[i].len + 1 != block_.size())
+            Set(i, std::string(get(i)));  // move to the end
+
+        block_.pop_back();
+        block_.append(val);
+        block_.push_back('\0');
+        slots_[i].len += val.size();
+    }
+
+    size_t size() const {
+        return block_.size();
+    }
+
+    // raw view for the shared memory export: N {ofs, len} pairs of uint32_t and the block
+    const void* slot_data() const {
+        return slots_.data();
+    }
+
+    std::string_view block() const {
+        return block_;
+    }
+};
+
+// string fields of OfpInfo, X(f) is expanded for each field
+#define OFP_FIELDS(X)       \
+    X(units)                \
+    X(status)               \
+    X(icao_airline)         \
+    X(flight_number)        \
+    X(aircraft_icao)        \
+    X(max_passengers)       \
+    X(fuel_plan_ramp)       \
+    X(origin)               \
+    X(origin_rwy)           \
+    X(sid)                  \
+    X(destination)          \
+    X(alternate)            \
+    X(destination_rwy)      \
+    X(ci)                   \
+    X(altitude)             \
+    X(tropopause)           \
+    X(isa_dev)              \
+    X(wind_component)       \
+    X(oew)                  \
+    X(pax_count)            \
+    X(freight)              \
+    X(payload)              \
+    X(route)                \
+    X(alt_route)            \
+    X(time_generated)       \
+    X(est_time_enroute)     \
+    X(est_out)              \
+    X(est_off)              \
+    X(est_on)               \
+    X(est_in)               \
+    X(fuel_taxi)            \
+    X(max_zfw)              \
+    X(max_tow)              \
+    X(dx_rmk)
+
+// numeric OFP fields, a subset of OFP_FIELDS
+#define OFP_INT_FIELDS(X)   \
+    X(max_passengers)       \
+    X(pax_count)            \
+    X(ci)                   \
+    X(altitude)             \
+    X(tropopause)           \
+    X(isa_dev)              \
+    X(wind_component)       \
+    X(time_generated)       \
+    X(est_time_enroute)     \
+    X(est_out)              \
+    X(est_off)              \
+    X(est_on)               \
+    X(est_in)
+
+#define OFP_FLOAT_FIELDS(X) \
+    X(fuel_plan_ramp)       \
+    X(fuel_taxi)            \
+    X(oew)                  \
+    X(freight)              \
+    X(payload)              \
+    X(max_zfw)              \
+    X(max_tow)
+
+// numeric fields parsed once on the worker thread
+// weights and fuel are in kg regardless of OfpInfo::units, altitude is a FL, times are unix epoch or s
+struct OfpNum {
+#define I(f) int f{0};
+#define R(f) float f{0.0f};
+    OFP_INT_FIELDS(I)
+    OFP_FLOAT_FIELDS(R)
+#undef I
+#undef R
+};
+
+// OFP times with a TimeView, X(f) is expanded for each time
+#define OFP_TIMES(X)        \
+    X(generated)            \
+    X(out)                  \
+    X(off)                  \
+    X(on)                   \
+    X(in)
+
+// CDM times with a TimeView
+#define CDM_TIMES(X)        \
+    X(tobt)                 \
+    X(tsat)                 \
+    X(ctot)
+
+// A point in time in the representations the UI and consumers need.
+// Filled once per activation on the worker thread, so nobody has to call gmtime/strftime.
+struct TimeView {
+    int epoch{0};       // unix epoch, 0 = unknown
+    int mins{-1};       // minutes since midnight UTC, -1 = unknown
+    char hhmm[5]{};     // "HHMM" UTC
+    char hh_mm[6]{};    // "HH:MM" UTC
+
+    void Set(time_t t) {
+        if (t <= 0) {
+            *this = TimeView();
+            return;
+        }
+
+        epoch = t;
+        mins = t % 86400 / 60;
+        int h = mins / 60, m = mins % 60;
+        hhmm[0] = hh_mm[0] = '0' + h / 10;
+        hhmm[1] = hh_mm[1] = '0' + h % 10;
+        hh_mm[2] = ':';
+        hhmm[2] = hh_mm[3] = '0' + m / 10;
+        hhmm[3] = hh_mm[4] = '0' + m % 10;
+        hhmm[4] = hh_mm[5] = '\0';
+    }
+
+    // from "HHMM" on the day that puts it closest to ref, so e.g. a TOBT of 0010 at 23:50 is tomorrow
+    void SetHHMM(std::string_view str, time_t ref) {
+        if (str.length() < 4) {
+            *this = TimeView();
+            return;
+        }
+
+        int v[4];
+        for (int i = 0; i < 4; i++) {
+            v[i] = str[i] - '0';
+            if (v[i] < 0 || v[i] > 9) {
+                *this = TimeView();
+                return;
+            }
+        }
+
+        int h = v[0] * 10 + v[1], m = v[2] * 10 + v[3];
+        if (h > 23 || m > 59) {
+            *this = TimeView();
+            return;
+        }
+
+        time_t t = ref - ref % 86400 + h * 3600 + m * 60;
+        if (t - ref > 43200)
+            t -= 86400;
+        else if (ref - t > 43200)
+            t += 86400;
+        Set(t);
+    }
+};
+
+struct OfpTimes {
+#define T(f) TimeView f;
+    OFP_TIMES(T)
+#undef T
+    int block_mins{-1};         // est_out -> est_in, -1 = unknown
+    int trip_mins{-1};          // est_time_enroute, -1 = unknown
+    char trip_hhmm[5]{};        // "HHMM"
+    char generated_utc[20]{};   // "YYYY-MM-DD HH:MM:SS"
+};
+
+struct CdmTimes {
+#define T(f) TimeView f;
+    CDM_TIMES(T)
+#undef T
+};
+
+// navlog.fix as structure of arrays so consumers can bulk read it with array datarefs
+struct Navlog {
+    std::string idents;             // interned idents, NUL terminated, back to back
+    std::vector<int> ident_ofs;     // offset of the ident of fix i in idents
+    std::vector<float> lat;         // deg
+    std::vector<float> lon;         // deg
+    std::vector<float> altitude;    // ft
+    std::vector<float> distance;    // nm, cumulative
+    std::vector<float> ete;         // s, cumulative
+    std::vector<float> fuel;        // planned fuel on board, OfpInfo::units
+    std::unordered_map<uint64_t, int> index;  // Fnv1a of an interned string -> offset in idents
+
+    int count() const {
+        return ident_ofs.size();
+    }
+
+    // offset of str in idents, appended if not yet there
+    int Intern(std::string_view str);
+    void AddFix(std::string_view ident, float lat, float lon, float altitude, float distance, float ete, float fuel);
+};
+
+// type of a route token
+enum RouteTokenType {
+    kTokenFix = 0,      // waypoint, navaid, coordinates, ...
+    kTokenAirway = 1,
+    kTokenSidStar = 2,
+    kTokenDct = 3,
+};
+
+// A route split into tokens once per download. Tokens are interned into Navlog::idents,
+// the string table shared with the navlog.
+struct RouteTokens {
+    std::vector<int> ofs;   // offset of token i in Navlog::idents
+    std::vector<int> type;  // RouteTokenType of token i
+
+    int count() const {
+        return ofs.size();
+    }
+};
+
+#define E(f) f,
+enum class OfpField { OFP_FIELDS(E) kNumFields };
+#undef E
+
+// getter f() and setter set_f() for field f
+#define F(f)                                    \
+    std::string_view f() const {                \
+        return fields.get((int)Field::f);       \
+    }                                           \
+    void set_##f(std::string_view val) {        \
+        fields.Set((int)Field::f, val);         \
+    }
 
-#define F(f) std::string f
 struct OfpInfo
 {
+    using Field = OfpField;
     int stale{false};   // int!, is accessed by a integer accessor
     int seqno{0};       // incremented after each successfull fetch
-    F(units);
-    F(status);
-    F(icao_airline);
-    F(flight_number);
-    F(aircraft_icao);
-    F(max_passengers);
-    F(fuel_plan_ramp);
-    F(origin);
-    F(origin_rwy);
-    F(sid);
-    F(destination);
-    F(alternate);
-    F(destination_rwy);
-    F(ci);
-    F(altitude);
-    F(tropopause);
-    F(isa_dev);
-    F(wind_component);
-    F(oew);
-    F(pax_count);
-    F(freight);
-    F(payload);
-    F(route);
-    F(alt_route);
-    F(time_generated);
-    F(est_time_enroute);
-    F(est_out);
-    F(est_off);
-    F(est_on);
-    F(est_in);
-    F(fuel_taxi);
-    F(max_zfw);
-    F(max_tow);
-    F(dx_rmk);
+    uint64_t hash{0};   // identifies the plan, see OfpHash()
+    FieldArena<(int)Field::kNumFields, 4096> fields;
+    OfpNum num;
+    OfpTimes times;
+    Navlog navlog;
+    RouteTokens route_tokens;
+    RouteTokens alt_route_tokens;
+    std::string raw;    // the OFP json as downloaded, for OfpQuery()
+    std::string pilot_id;  // the OFP was fetched for
+
+    OFP_FIELDS(F)
     void Dump() const;
 };
 
+// string fields of CdmInfo
+#define CDM_FIELDS(X)       \
+    X(url)                  \
+    X(status)               \
+    X(tobt)                 \
+    X(tsat)                 \
+    X(ctot)                 \
+    X(runway)               \
+    X(sid)
+
+#define E(f) f,
+enum class CdmField { CDM_FIELDS(E) kNumFields };
+#undef E
+
+// outcome of CdmGetParse()
+enum CdmOutcome {
+    kCdmFound = 0,
+    kCdmNotFound = 1,   // a server answered but does not know the flight
+    kCdmError = 2,      // no server answered: down, breaker open or network error
+};
+
 struct CdmInfo
 {
+    using Field = CdmField;
     int seqno{0};       // incremented after each successfull fetch
-    F(url);
-    F(status);
-    F(tobt);
-    F(tsat);
-    F(ctot);
-    F(runway);
-    F(sid);
+    int outcome{kCdmError};  // CdmOutcome
+    FieldArena<(int)Field::kNumFields, 256> fields;
+    CdmTimes times;     // from tobt, tsat, ctot
+
+    CDM_FIELDS(F)
     void Dump() const;
 };
 #undef F
 
 extern bool error_disabled;
 extern bool ofp_download_active;
+extern bool ofp_fetch_pending;
 
 extern std::string pilot_id;
+extern std::string ofp_fetch_error;  // status of the last download if it failed, "" otherwise
+extern int pref_ofp_poll_min;
+extern int pref_ofp_history;
+extern void OfpHistoryResize();
 extern std::unique_ptr<OfpInfo> ofp_info;
 extern std::unique_ptr<CdmInfo> cdm_info;
 
-extern void FetchOfp(void);
-extern bool OfpGetParse(const std::string& pilot_id, std::unique_ptr<OfpInfo>& ofp_info);
+static constexpr float kFetchDebounce = 0.5f;    // s, collapses bursts of fetch requests
+static constexpr float kPilotIdDebounce = 2.0f;  // s, the edited pilot id must be stable that long
+
+extern void FetchOfp(float delay = kFetchDebounce);
+extern OfpFetchResult OfpGetParse(const std::string& pilot_id, uint64_t active_hash, std::unique_ptr<OfpInfo>& ofp_info);
+extern OfpFetchResult OfpParseResponse(const std::string& pilot_id, uint64_t active_hash, const std::string& json_str,
+                                       OfpInfo& ofp_info);
+extern bool OfpParse(const std::string& json_str, OfpInfo& ofp_info);
+extern bool OfpQuery(const OfpInfo& ofp_info, std::string_view pointer, std::string& value);
+extern bool OfpSaveSnapshot(const std::string& path, const std::string& pilot_id, const OfpInfo& ofp_info);
+extern bool OfpLoadSnapshot(const std::string& path, const std::string& pilot_id, std::unique_ptr<OfpInfo>& ofp_info);
 extern bool CdmInit(const std::string& cfg_path);
+
+// Load the persistent cache of the airport lists of the cdm servers, call after CdmInit().
+// Updated lists are saved to path.
+extern bool CdmLoadAirportCache(const std::string& path);
+
+// Wait for background downloads of the cdm servers and release them, call from XPluginStop()
+// after the last CdmGetParse() has finished.
+extern void CdmFini();
+
+// circuit breaker state of a cdm server
+enum CdmServerState {
+    kCdmClosed = 0,     // requests pass
+    kCdmOpen = 1,       // down, requests are refused until next_probe
+    kCdmHalfOpen = 2,   // a probe request is in flight
+};
+
+struct CdmServerStats {
+    int state;          // CdmServerState
+    int next_probe;     // unix time, 0 if closed
+};
+
+// in config file order
+extern std::vector<CdmServerStats> CdmGetServerStats();
+
+// distinct hosts of the servers and of the feeds in their airport lists, e.g. for prewarming
+extern std::vector<std::string> CdmGetServerUrls();
+
+// why the next cdm poll is scheduled when it is
+enum CdmPollReason {
+    kCdmPollStart = 0,        // OFP activated, poll now
+    kCdmPollNoData = 1,       // flight known but no TOBT/TSAT yet
+    kCdmPollFar = 2,          // TSAT (or TOBT) far off
+    kCdmPollApproaching = 3,  // TSAT approaching
+    kCdmPollNear = 4,         // final minutes before TSAT
+    kCdmPollNotFound = 5,     // flight not found, backoff
+    kCdmPollError = 6,        // no server answered
+};
+
+// Delay in s until the next poll derived from the result of a poll, cdm_info.outcome tells how it went.
+// n_not_found = number of consecutive polls that did not find the flight, including this one.
+extern int CdmPollDelay(const CdmInfo& cdm_info, int n_not_found, int& reason);
 extern bool CdmGetParse(const std::string& icao, const std::string& callsign, std::unique_ptr<CdmInfo>& Cdm_info);
 extern void SavePrefs();
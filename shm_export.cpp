@@ -0,0 +1,184 @@
+//
+//    Simbrief Hub: A central resource of simbrief data for other plugins
+//
+//    Copyright (C) 2026 Holger Teutsch
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Lesser General Public
+//    License as published by the Free Software Foundation; either
+//    version 2.1 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+//    USA
+//
+
+
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#ifdef IBM
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "sbh.h"
+#include "shm_export.h"
+
+// capacity of the string blocks, a long haul OFP uses ~2k
+static constexpr uint32_t kOfpBlockSize = 64 * 1024;
+static constexpr uint32_t kCdmBlockSize = 4 * 1024;
+
+static constexpr uint32_t kOfpFields = (uint32_t)OfpField::kNumFields;
+static constexpr uint32_t kCdmFields = (uint32_t)CdmField::kNumFields;
+
+static constexpr uint32_t SectionSize(uint32_t n_fields, uint32_t block_size) {
+    return (sizeof(ShmSection) + n_fields * 2 * sizeof(uint32_t) + block_size + 7) & ~7u;
+}
+
+static constexpr uint32_t kOfpOfs = (sizeof(ShmHeader) + 7) & ~7u;
+static constexpr uint32_t kCdmOfs = kOfpOfs + SectionSize(kOfpFields, kOfpBlockSize);
+static constexpr uint32_t kShmSize = kCdmOfs + SectionSize(kCdmFields, kCdmBlockSize);
+
+static char* base;  // of the mapping, nullptr = export is unavailable
+
+#ifdef IBM
+static HANDLE file_h = INVALID_HANDLE_VALUE, map_h = NULL;
+
+static char* Map(const std::string& path) {
+    file_h = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                         OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file_h == INVALID_HANDLE_VALUE)
+        return nullptr;
+
+    map_h = CreateFileMappingA(file_h, NULL, PAGE_READWRITE, 0, kShmSize, NULL);
+    if (map_h == NULL)
+        return nullptr;
+
+    return static_cast<char*>(MapViewOfFile(map_h, FILE_MAP_ALL_ACCESS, 0, 0, kShmSize));
+}
+
+static void Unmap() {
+    if (base)
+        UnmapViewOfFile(base);
+    if (map_h)
+        CloseHandle(map_h);
+    if (file_h != INVALID_HANDLE_VALUE)
+        CloseHandle(file_h);
+    map_h = NULL;
+    file_h = INVALID_HANDLE_VALUE;
+}
+
+#else
+static char* Map(const std::string& path) {
+    int fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+        return nullptr;
+
+    void* p = MAP_FAILED;
+    if (ftruncate(fd, kShmSize) == 0)
+        p = mmap(nullptr, kShmSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);  // the mapping stays valid
+    return p == MAP_FAILED ? nullptr : static_cast<char*>(p);
+}
+
+static void Unmap() {
+    if (base)
+        munmap(base, kShmSize);
+}
+#endif
+
+static ShmSection* Section(uint32_t ofs) {
+    return reinterpret_cast<ShmSection*>(base + ofs);
+}
+
+bool ShmInit(const std::string& path) {
+    base = Map(path);
+    if (base == nullptr) {
+        LogMsg("Can't map '%s', shared memory export is disabled", path.c_str());
+        Unmap();
+        return false;
+    }
+
+    // a reader must not see a valid magic before the layout is complete
+    auto hdr = reinterpret_cast<ShmHeader*>(base);
+    memset(base, 0, kShmSize);
+    hdr->version = kShmVersion;
+    hdr->size = kShmSize;
+    hdr->ofp_ofs = kOfpOfs;
+    hdr->cdm_ofs = kCdmOfs;
+    Section(kOfpOfs)->n_fields = kOfpFields;
+    Section(kOfpOfs)->block_size = kOfpBlockSize;
+    Section(kCdmOfs)->n_fields = kCdmFields;
+    Section(kCdmOfs)->block_size = kCdmBlockSize;
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(hdr->magic, kShmMagic, sizeof(hdr->magic));
+
+    LogMsg("Shared memory export to '%s', %u bytes", path.c_str(), kShmSize);
+    return true;
+}
+
+void ShmFini() {
+    Unmap();
+    base = nullptr;
+}
+
+// write a section under the seqlock
+// the FieldArena is copied as is: its slots are the {ofs, len} table and its block the string block
+template <class Info>
+static void Publish(uint32_t ofs, const Info* info, int stale) {
+    if (base == nullptr)
+        return;
+
+    ShmSection* sec = Section(ofs);
+    char* slots = reinterpret_cast<char*>(sec + 1);
+    const size_t slots_size = sec->n_fields * 2 * sizeof(uint32_t);
+    char* block = slots + slots_size;
+
+    std::string_view blk = info ? info->fields.block() : std::string_view();
+    if (blk.size() > sec->block_size) {
+        LogMsg("Shared memory export: string block of %d bytes exceeds %u, section is cleared", (int)blk.size(),
+               sec->block_size);
+        info = nullptr;
+    }
+
+    std::atomic_ref<uint32_t> gen(sec->gen);
+    uint32_t g = gen.load(std::memory_order_relaxed);
+    gen.store(g + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    if (info) {
+        memcpy(slots, info->fields.slot_data(), slots_size);
+        memcpy(block, blk.data(), blk.size());
+        sec->seqno = info->seqno;
+        sec->stale = stale;
+        sec->block_len = blk.size();
+    } else {
+        memset(slots, 0, slots_size);  // all fields are the empty string at block[0]
+        block[0] = '\0';
+        sec->seqno = 0;
+        sec->stale = 0;
+        sec->block_len = 1;
+    }
+
+    gen.store(g + 2, std::memory_order_release);
+}
+
+void ShmPublishOfp(const OfpInfo* ofp_info) {
+    Publish(kOfpOfs, ofp_info, ofp_info ? ofp_info->stale : 0);
+}
+
+void ShmPublishCdm(const CdmInfo* cdm_info) {
+    Publish(kCdmOfs, cdm_info, 0);
+}
@@ -0,0 +1,72 @@
+//
+//    Simbrief Hub: A central resource of simbrief data for other plugins
+//
+//    Copyright (C) 2026 Holger Teutsch
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Lesser General Public
+//    License as published by the Free Software Foundation; either
+//    version 2.1 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+//    USA
+//
+
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Export of the active OfpInfo and CdmInfo into a memory-mapped file for out-of-process readers.
+//
+// Layout, all integers are uint32_t/int32_t in native byte order:
+//
+//   ShmHeader
+//   ShmSection    OFP at ShmHeader::ofp_ofs
+//   ShmSection    CDM at ShmHeader::cdm_ofs
+//
+// A ShmSection is followed by n_fields {ofs, len} pairs and a string block of block_size bytes.
+// Field i is the len bytes at block + ofs (NUL terminated). Field order is that of OFP_FIELDS/CDM_FIELDS.
+//
+// Each section is guarded by a seqlock: gen is odd while the plugin writes.
+// A reader loads gen (acquire), retries if it's odd, copies what it needs, loads gen again and
+// retries if it has changed.
+
+static constexpr char kShmMagic[8] = "sbh_shm";
+static constexpr uint32_t kShmVersion = 1;
+
+struct ShmHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t size;      // of the whole file
+    uint32_t ofp_ofs;   // of the OFP ShmSection
+    uint32_t cdm_ofs;   // of the CDM ShmSection
+};
+
+struct ShmSection {
+    uint32_t gen;         // seqlock generation, odd while being written
+    int32_t seqno;        // seqno of the OfpInfo/CdmInfo, 0 = no data
+    int32_t stale;        // OFP only
+    uint32_t n_fields;
+    uint32_t block_size;  // capacity of the string block
+    uint32_t block_len;   // bytes in use
+};
+
+struct OfpInfo;
+struct CdmInfo;
+
+// create and map the file, returns false if the export is unavailable
+extern bool ShmInit(const std::string& path);
+extern void ShmFini();
+
+// publish the active info, nullptr clears the section
+extern void ShmPublishOfp(const OfpInfo* ofp_info);
+extern void ShmPublishCdm(const CdmInfo* cdm_info);
@@ -22,6 +22,7 @@
 //    USA
 //
 
+#include <algorithm>
 #include <string>
 #include <vector>
 #include <memory>
@@ -47,11 +48,54 @@ static constexpr float kFontSize = 13.0f;
 std::unique_ptr<ImgWindow> ui;
 int ui_left = -1, ui_top, ui_right, ui_bottom;  // -1 = not loaded from prefs
 
+// Lines of a route wrapped at the available width.
+// Recomputed from the route tokens only for a new OFP or a changed width.
+struct RouteLines {
+    int seqno{-1};
+    float width{-1.0f};
+    std::vector<std::string> lines;
+
+    void Update(const OfpInfo& ofp_info, const RouteTokens& tokens, float width);
+};
+
+void RouteLines::Update(const OfpInfo& ofp_info, const RouteTokens& tokens, float width_) {
+    if (seqno == ofp_info.seqno && width == width_)
+        return;
+
+    seqno = ofp_info.seqno;
+    width = width_;
+    lines.clear();
+
+    const float space_w = ImGui::CalcTextSize(" ").x;
+    std::string line;
+    float line_w = 0.0f;
+    for (int i = 0; i < tokens.count(); i++) {
+        const char* token = ofp_info.navlog.idents.c_str() + tokens.ofs[i];
+        float w = ImGui::CalcTextSize(token).x;
+        if (!line.empty() && line_w + space_w + w > width) {
+            lines.push_back(std::move(line));
+            line.clear();
+            line_w = 0.0f;
+        }
+
+        if (!line.empty()) {
+            line.push_back(' ');
+            line_w += space_w;
+        }
+        line.append(token);
+        line_w += w;
+    }
+
+    if (!line.empty())
+        lines.push_back(std::move(line));
+}
+
 // Our own class defining the UI
 class Ui : public ImgWindow {
     XPLMFlightLoopID flt_id_ = nullptr;
     int ofp_seqno_ = 0;
-    std::string out_, off_, tropo_, trip_time_, status_line_;
+    std::string tropo_, trip_time_, status_line_;
+    RouteLines route_lines_, alt_route_lines_;
     ImVec4 field_color_ = ImColor(0.0f, 0.5f, 0.3f, 1.0f);
 
     // Main function: creates the window's UI
@@ -130,37 +174,18 @@ void Ui::BuildInterface() {
     if (ofp_info && ofp_info->seqno > ofp_seqno_) {
         ofp_seqno_ = ofp_info->seqno;
 
-        if (ofp_info->status != kSuccess) {
-            status_line_ = ofp_info->status;
+        if (ofp_info->status() != kSuccess) {
+            status_line_ = ofp_info->status();
         } else {
-            time_t tg = atol(ofp_info->time_generated.c_str());
-            auto tm = *gmtime(&tg);
-
-            status_line_ = std::format("{}{} {} / OFP generated at {:04}-{:02}-{:02} {:02}:{:02}:{:02} UTC, seqno: {}",
-                                      ofp_info->icao_airline, ofp_info->flight_number, ofp_info->aircraft_icao,
-                                      tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec,
+            const OfpTimes& times = ofp_info->times;
+            status_line_ = std::format("{}{} {} / OFP generated at {} UTC, seqno: {}", ofp_info->icao_airline(),
+                                      ofp_info->flight_number(), ofp_info->aircraft_icao(), times.generated_utc,
                                       ofp_info->seqno);
 
-            time_t out_time = atol(ofp_info->est_out.c_str());
-            time_t off_time = atol(ofp_info->est_off.c_str());
-
-            auto out_tm = *gmtime(&out_time);
-            auto off_tm = *gmtime(&off_time);
-            char out[20], off[20];
-            strftime(out, sizeof(out), "%H:%M", &out_tm);
-            strftime(off, sizeof(off), "%H:%M", &off_tm);
-            out_ = out;
-            off_ = off;
-
-            int tropopause = atoi(ofp_info->tropopause.c_str());
+            int tropopause = ofp_info->num.tropopause;
             tropopause = (tropopause + 500) / 1000 * 1000;  // round to nearest 1000
             tropo_ = std::to_string(tropopause);
-
-            if (ofp_info->est_time_enroute[0]) {
-                int ttmin = (atoi(ofp_info->est_time_enroute.c_str()) + 30) / 60;
-                trip_time_ = std::format("{:02d}{:02d}", ttmin / 60, ttmin % 60);
-            } else
-                trip_time_ = "<unknown>";
+            trip_time_ = times.trip_mins >= 0 ? times.trip_hhmm : "<unknown>";
         }
     }
 
@@ -170,7 +195,20 @@ void Ui::BuildInterface() {
         ImGui::AlignTextToFramePadding();
         ImGui::TextUnformatted("Pilot ID:");
         ImGui::SameLine();
-        ImGui::InputText("##pilot_id", &pilot_id);
+        if (ImGui::InputText("##pilot_id", &pilot_id) && !pilot_id.empty())
+            FetchOfp(kPilotIdDebounce);  // fetch when the pilot id has settled
+        ImGui::AlignTextToFramePadding();
+        ImGui::TextUnformatted("Check for new OFP every (min, 0 = off):");
+        ImGui::SameLine();
+        ImGui::SetNextItemWidth(0.6f * kFontSize * 10.0f);
+        if (ImGui::InputInt("##ofp_poll", &pref_ofp_poll_min))
+            pref_ofp_poll_min = std::clamp(pref_ofp_poll_min, 0, 60);
+        ImGui::AlignTextToFramePadding();
+        ImGui::TextUnformatted("Previous OFPs to keep:");
+        ImGui::SameLine();
+        ImGui::SetNextItemWidth(0.6f * kFontSize * 10.0f);
+        if (ImGui::InputInt("##ofp_history", &pref_ofp_history))
+            OfpHistoryResize();
         ImGui::Spacing();
         ImGui::Separator();
         ImGui::TreePop();
@@ -196,13 +234,18 @@ void Ui::BuildInterface() {
     }
     ImGui::Spacing();
     ImGui::Separator();
-    ImGui::TextUnformatted(status_line_.c_str());
+    if (ofp_info && ofp_info->status() == kSuccess)
+        ImGui::TextUnformatted(status_line_.c_str());
+    if (ofp_info && ofp_info->stale && ofp_info->status() == kSuccess)
+        ImGui::TextUnformatted("Data may be stale (from last session or download failed)");
+    if (!ofp_fetch_error.empty())
+        ImGui::Text("Last download failed: %s", ofp_fetch_error.c_str());
 
     //--------------------------------------------------
     ImGui::Spacing();
     ImGui::Separator();
 
-    if (ofp_info && ofp_info->status == kSuccess) {
+    if (ofp_info && ofp_info->status() == kSuccess) {
         float col_0 = ImGui::GetCursorPosX();
         float left_col[2]{
             col_0,
@@ -214,20 +257,19 @@ void Ui::BuildInterface() {
             left_col[1] + 0.6f * kFontSize * 12.0f,
         };
 
-        auto DF = [&](int col, const std::string& label, const std::string& value) {
+        auto DF = [&](int col, const std::string& label, std::string_view value) {
             if (col == 1)
                 ImGui::SameLine();
             ImGui::SetCursorPosX(left_col[col]);
             ImGui::TextUnformatted(label.c_str());
             ImGui::SameLine();
             ImGui::SetCursorPosX(right_col[col]);
-            ImGui::TextColored(field_color_, "%s", value.c_str());
+            ImGui::TextColored(field_color_, "%.*s", (int)value.size(), value.data());
         };
 
-        auto DF_pm = [&](int col, const std::string& label, std::string value) {
+        auto DF_pm = [&](int col, const std::string& label, int ivalue) {
             if (col == 1)
                 ImGui::SameLine();
-            int ivalue = atoi(value.c_str());
             ImGui::SetCursorPosX(left_col[col]);
             ImGui::TextUnformatted(label.c_str());
             ImGui::SameLine();
@@ -238,78 +280,67 @@ void Ui::BuildInterface() {
                 ImGui::TextColored(field_color_, "P%03d", ivalue);
         };
 
-        auto FormatRoute = [&](std::string_view route, float right_col) {
+        auto FormatRoute = [&](RouteLines& route_lines, const RouteTokens& tokens, float right_col) {
             ImGui::SameLine();
-            if (route.empty()) {
+            ImGui::SetCursorPosX(right_col);
+            route_lines.Update(*ofp_info, tokens, ImGui::GetContentRegionAvail().x);
+            if (route_lines.lines.empty()) {
                 ImGui::SetCursorPosX(right_col);
                 ImGui::TextColored(field_color_, "<empty>");
                 return;
             }
 
-            static constexpr size_t kRouteBrk = 50;
-            while (route.length() > kRouteBrk) {
-                size_t space_pos = route.find_last_of(' ', kRouteBrk);
-                if (space_pos == std::string_view::npos) {
-                    LogMsg("Can't format route!");
-                    break;
-                }
-
-                auto fragment = route.substr(0, space_pos);
+            for (const auto& line : route_lines.lines) {
                 ImGui::SetCursorPosX(right_col);
-                ImGui::TextColored(field_color_, "%.*s", static_cast<int>(fragment.length()), fragment.data());
-
-                route.remove_prefix(space_pos + 1);
+                ImGui::TextColored(field_color_, "%s", line.c_str());
             }
-
-            ImGui::SetCursorPosX(right_col);
-            ImGui::TextColored(field_color_, "%.*s", static_cast<int>(route.length()), route.data());
         };
 
-        DF(0, "Pax:", ofp_info->pax_count);
-        DF(0, "Cargo:", ofp_info->freight);
-        DF(0, "Fuel:", ofp_info->fuel_plan_ramp);
+        DF(0, "Pax:", ofp_info->pax_count());
+        DF(0, "Cargo:", ofp_info->freight());
+        DF(0, "Fuel:", ofp_info->fuel_plan_ramp());
 
         ImGui::Spacing();
-        DF(0, "Out:", out_);
-        DF(1, "Off:", off_);
+        DF(0, "Out:", ofp_info->times.out.hh_mm);
+        DF(1, "Off:", ofp_info->times.off.hh_mm);
         ImGui::Spacing();
         ImGui::Spacing();
 
-        DF(0, "Departure:", ofp_info->origin + "/" + ofp_info->origin_rwy);
-        DF(0, "Destination:", ofp_info->destination + "/" + ofp_info->destination_rwy);
+        DF(0, "Departure:", std::format("{}/{}", ofp_info->origin(), ofp_info->origin_rwy()));
+        DF(0, "Destination:", std::format("{}/{}", ofp_info->destination(), ofp_info->destination_rwy()));
         ImGui::TextUnformatted("Route:");
-        FormatRoute(ofp_info->route, right_col[0]);
+        FormatRoute(route_lines_, ofp_info->route_tokens, right_col[0]);
 
         DF(0, "Trip Time:", trip_time_);
 
-        DF(0, "CI:", ofp_info->ci);
+        DF(0, "CI:", ofp_info->ci());
         DF(1, "TROPO:", tropo_);
 
-        DF(0, "CRZ FL:", ofp_info->altitude);
-        DF_pm(1, "ISA:", ofp_info->isa_dev);
+        DF(0, "CRZ FL:", ofp_info->altitude());
+        DF_pm(1, "ISA:", ofp_info->num.isa_dev);
 
-        DF_pm(0, "WC:", ofp_info->wind_component);
+        DF_pm(0, "WC:", ofp_info->num.wind_component);
 
         ImGui::Spacing();
-        DF(0, "Alternate:", ofp_info->alternate);
+        DF(0, "Alternate:", ofp_info->alternate());
         ImGui::TextUnformatted("Alt Route:");
-        FormatRoute(ofp_info->alt_route, right_col[0]);
+        FormatRoute(alt_route_lines_, ofp_info->alt_route_tokens, right_col[0]);
 
-        DF(0, "DX Remarks:", ofp_info->dx_rmk);
+        DF(0, "DX Remarks:", ofp_info->dx_rmk());
 
         ImGui::Spacing();
         ImGui::Spacing();
         ImGui::Separator();
         if (cdm_info) {
-            DF(0, "CDM Status:", cdm_info->status);
-            DF(0, "CDM Url:", cdm_info->url);
-
-            if (cdm_info->status == kSuccess) {
-                DF(0, "TOBT:", cdm_info->tobt);
-                DF(1, "TSAT:", cdm_info->tsat);
-                DF(0, "CTOT:", cdm_info->ctot);
-                DF(0, "Runway:", cdm_info->runway);
-                DF(1, "SID:", cdm_info->sid);
+            DF(0, "CDM Status:", cdm_info->status());
+            DF(0, "CDM Url:", cdm_info->url());
+
+            if (cdm_info->status() == kSuccess) {
+                DF(0, "TOBT:", cdm_info->tobt());
+                DF(1, "TSAT:", cdm_info->tsat());
+                DF(0, "CTOT:", cdm_info->ctot());
+                DF(0, "Runway:", cdm_info->runway());
+                DF(1, "SID:", cdm_info->sid());
             }
         }
     }